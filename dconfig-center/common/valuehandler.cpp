@@ -58,6 +58,15 @@ public:
         }
     }
 
+    void resetAll() override
+    {
+        auto reply = manager->resetAll();
+        reply.waitForFinished();
+        if (reply.isError()) {
+            qWarning() << "resetAll error, error message:" << reply.error().message();
+        }
+    }
+
     QString permissions(const QString &key) const override
     {
         return manager->permissions(key);
@@ -187,6 +196,12 @@ public:
         setValue(key, v);
     }
 
+    void resetAll() override
+    {
+        for (const auto &key : keyList())
+            reset(key);
+    }
+
     QString permissions(const QString &key) const override
     {
         return manager->meta()->permissions(key) == DTK_CORE_NAMESPACE::DConfigFile::ReadWrite ? QString("readwrite") : QString("readonly");
@@ -16,6 +16,7 @@ public:
     virtual void setValue(const QString &key, const QVariant &value) = 0;
     virtual QVariant value(const QString &key) const = 0;
     virtual void reset(const QString &key) = 0;
+    virtual void resetAll() = 0;
     virtual QString permissions(const QString &key) const = 0;
     virtual QString visibility(const QString &key) const = 0;
     virtual QString displayName(const QString &key, const QString &locale) = 0;
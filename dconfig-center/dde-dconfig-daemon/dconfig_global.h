@@ -30,7 +30,11 @@ static const QString VirtualInterAppId = "_";
 
 inline QString formatDBusObjectPath(QString path)
 {
-    return path.replace(QRegularExpression(QStringLiteral("[\\. -]")), QStringLiteral("_"));
+    for (QChar &ch : path) {
+        if (ch == QLatin1Char('.') || ch == QLatin1Char(' ') || ch == QLatin1Char('-'))
+            ch = QLatin1Char('_');
+    }
+    return path;
 }
 inline QString outerAppidToInner(const QString &appid)
 {
@@ -46,19 +50,23 @@ inline bool isGenericResourceConn(const ConnKey &connKey)
 }
 inline ResourceKey getResourceKey(const QString &appid, const GenericResourceKey &key)
 {
-    return QString("/%1%2").arg(appid).arg(key);
+    return QLatin1Char('/') + appid + key;
 }
 inline ResourceKey getResourceKey(const ConnKey &connKey)
 {
     return connKey.left(connKey.lastIndexOf('/'));
 }
+inline QString getAppidByResourceKey(const ResourceKey &resourceKey)
+{
+    return resourceKey.mid(1, resourceKey.indexOf('/', 1) - 1);
+}
 inline GenericResourceKey getGenericResourceKeyByResourceKey(const ResourceKey &resourceKey)
 {
     return resourceKey.mid(resourceKey.indexOf('/', 1));
 }
 inline GenericResourceKey getGenericResourceKey(const QString &name, const QString &subpath)
 {
-    return QString("/%1%2").arg(name, subpath);
+    return QLatin1Char('/') + name + subpath;
 }
 inline GenericResourceKey getGenericResourceKey(const ConnKey &connKey)
 {
@@ -70,7 +78,7 @@ inline uint getConnectionKey(const ConnKey &connKey)
 }
 inline ConnKey getConnectionKey(const ResourceKey &key, const uint uid)
 {
-    return QString("%1/%2").arg(key).arg(uid);
+    return key + QLatin1Char('/') + QString::number(uid);
 }
 
 struct ConfigureId {
@@ -0,0 +1,139 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigaccessprofile.h"
+
+#include <QDateTime>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDebug>
+#include <cmath>
+#include <algorithm>
+
+static constexpr quint32 AccessProfileMagic = 0x44534741; // "DSGA"
+static constexpr quint32 AccessProfileVersion = 1;
+// the weight of an acquisition is halved after a week.
+static constexpr double ScoreHalfLife = 7 * 24 * 3600;
+
+void ConfigAccessProfile::record(const QString &appid, const QString &name, const QString &subpath)
+{
+    record(appid, name, subpath, QDateTime::currentSecsSinceEpoch());
+}
+
+/*!
+ \brief 记录一次资源获取
+ \a appid 应用ID，为内部ID
+ \a time 获取时间，自纪元起的秒数
+ */
+void ConfigAccessProfile::record(const QString &appid, const QString &name, const QString &subpath, const qint64 time)
+{
+    auto &item = m_records[getResourceKey(appid, getGenericResourceKey(name, subpath))];
+    if (item.count == 0) {
+        item.appid = appid;
+        item.name = name;
+        item.subpath = subpath;
+    }
+    item.count++;
+    item.lastAccess = qMax(item.lastAccess, time);
+}
+
+void ConfigAccessProfile::remove(const ResourceKey &key)
+{
+    m_records.remove(key);
+}
+
+int ConfigAccessProfile::size() const
+{
+    return m_records.size();
+}
+
+/*!
+ \brief 获取次数随最近获取时间衰减后的热度
+ */
+double ConfigAccessProfile::score(const ConfigAccessRecord &record, const qint64 now)
+{
+    const qint64 age = qMax<qint64>(0, now - record.lastAccess);
+    return record.count * std::exp2(-age / ScoreHalfLife);
+}
+
+/*!
+ \brief 获取热度最高的资源
+ \a count 资源数量
+ \a now 当前时间，自纪元起的秒数
+ \return 按热度从高到低排序的记录
+ */
+QList<ConfigAccessRecord> ConfigAccessProfile::hottest(const int count, const qint64 now) const
+{
+    QList<ConfigAccessRecord> records = m_records.values();
+    std::sort(records.begin(), records.end(), [now](const ConfigAccessRecord &r1, const ConfigAccessRecord &r2) {
+        return score(r1, now) > score(r2, now);
+    });
+    if (records.size() > count)
+        records.erase(records.begin() + qMax(0, count), records.end());
+    return records;
+}
+
+bool ConfigAccessProfile::load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0, count = 0;
+    stream >> magic >> version;
+    if (magic != AccessProfileMagic || version != AccessProfileVersion) {
+        qCWarning(cfLog()) << "Ignore the access profile of unknown version:" << path;
+        return false;
+    }
+
+    stream >> count;
+    QHash<ResourceKey, ConfigAccessRecord> records;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        ConfigAccessRecord record;
+        stream >> record.appid >> record.name >> record.subpath >> record.count >> record.lastAccess;
+        records.insert(getResourceKey(record.appid, getGenericResourceKey(record.name, record.subpath)), record);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(cfLog()) << "Ignore the broken access profile:" << path;
+        return false;
+    }
+
+    m_records = records;
+    return true;
+}
+
+/*!
+ \brief 保存热度最高的记录
+ \a path 文件路径
+ \a maxCount 最多保存的记录数量，冷门资源被丢弃
+ \return 是否保存成功
+ */
+bool ConfigAccessProfile::save(const QString &path, const int maxCount) const
+{
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return false;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(cfLog()) << "Failed to save the access profile:" << file.errorString();
+        return false;
+    }
+
+    const auto &records = hottest(maxCount, QDateTime::currentSecsSinceEpoch());
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << AccessProfileMagic << AccessProfileVersion << static_cast<quint32>(records.size());
+    for (const auto &record : records)
+        stream << record.appid << record.name << record.subpath << record.count << record.lastAccess;
+
+    if (!file.commit()) {
+        qCWarning(cfLog()) << "Failed to save the access profile:" << file.errorString();
+        return false;
+    }
+    return true;
+}
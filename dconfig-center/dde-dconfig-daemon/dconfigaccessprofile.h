@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief The ConfigAccessRecord struct
+ * 资源在某个应用下被获取的次数及最近获取时间
+ */
+struct ConfigAccessRecord {
+    QString appid; // inner appid
+    QString name;
+    QString subpath;
+    quint32 count = 0;
+    // seconds since epoch
+    qint64 lastAccess = 0;
+};
+
+/**
+ * @brief The ConfigAccessProfile class
+ * 记录资源的获取频率及最近获取时间，按热度排序供服务启动后预加载
+ */
+class ConfigAccessProfile
+{
+public:
+    void record(const QString &appid, const QString &name, const QString &subpath);
+    void record(const QString &appid, const QString &name, const QString &subpath, const qint64 time);
+    void remove(const ResourceKey &key);
+    int size() const;
+    QList<ConfigAccessRecord> hottest(const int count, const qint64 now) const;
+
+    bool load(const QString &path);
+    bool save(const QString &path, const int maxCount) const;
+
+    static double score(const ConfigAccessRecord &record, const qint64 now);
+
+private:
+    QHash<ResourceKey, ConfigAccessRecord> m_records;
+};
@@ -0,0 +1,248 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigchannel.h"
+#include "dconfigserver.h"
+#include "dconfigconn.h"
+
+#include <QDBusServer>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QFile>
+#include <QUuid>
+#include <QDebug>
+
+#include <algorithm>
+
+#include <dbus/dbus.h>
+#include <sys/socket.h>
+
+// limits file descriptors used by channels.
+static constexpr int MaxChannelCount = 256;
+// the channel is closed if it's not connected in time.
+static constexpr int ConnectTimeout = 10000;
+static constexpr int CheckInterval = 5000;
+
+// the peer of any user passes EXTERNAL authentication, its uid is checked when it's connected.
+static dbus_bool_t allowAnyUnixUser(DBusConnection *connection, unsigned long uid, void *data)
+{
+    Q_UNUSED(connection)
+    Q_UNUSED(uid)
+    Q_UNUSED(data)
+    return TRUE;
+}
+
+// the uid of the connected process is taken from the kernel, it can't be forged by the peer.
+static bool peerUid(const QDBusConnection &connection, uint &uid)
+{
+    auto rawConnection = static_cast<DBusConnection *>(connection.internalPointer());
+    int fd = -1;
+    if (!rawConnection || !dbus_connection_get_socket(rawConnection, &fd))
+        return false;
+
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        return false;
+
+    uid = credentials.uid;
+    return true;
+}
+
+ConfigDirectChannelRoot::ConfigDirectChannelRoot(DSGConfigServer *server, PeerCredentialsCache *credentials, QObject *parent)
+    : QObject(parent)
+    , m_server(server)
+    , m_credentials(credentials)
+{
+}
+
+/*!
+ \brief 以对端用户的身份获取配置连接
+ */
+QDBusObjectPath ConfigDirectChannelRoot::acquireManager(const QString &appid, const QString &name, const QString &subpath)
+{
+    const auto &service = PeerCredentialsCache::serviceName(connection(), message());
+    uint uid = 0;
+    if (!m_credentials->uid(connection(), service, uid)) {
+        QString errorMsg = QString("Can't get the credentials of the service [%1].").arg(service);
+        sendErrorReply(QDBusError::AccessDenied, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return QDBusObjectPath();
+    }
+    return acquireManagerV2(uid, appid, name, subpath);
+}
+
+/*!
+ \brief 获取配置连接，连接对象同时注册到此通道上
+ */
+QDBusObjectPath ConfigDirectChannelRoot::acquireManagerV2(const uint &uid, const QString &appid, const QString &name, const QString &subpath)
+{
+    const auto &service = PeerCredentialsCache::serviceName(connection(), message());
+    QString errorMsg;
+    auto conn = m_server->acquireConnection(service, uid, appid, name, subpath, errorMsg);
+    if (!conn) {
+        sendErrorReply(QDBusError::Failed, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return QDBusObjectPath();
+    }
+
+    // it's registered already if the peer acquires it again.
+    auto bus = connection();
+    if (!bus.objectRegisteredAt(conn->path()))
+        bus.registerObject(conn->path(), conn, QDBusConnection::ExportAdaptors);
+
+    return QDBusObjectPath(conn->path());
+}
+
+ConfigDirectChannels::ConfigDirectChannels(DSGConfigServer *server, PeerCredentialsCache *credentials, QObject *parent)
+    : QObject(parent)
+    , m_root(new ConfigDirectChannelRoot(server, credentials, this))
+    , m_credentials(credentials)
+{
+    // `RUNTIME_DIRECTORY` is set by systemd, it's traversable but not listable by other users.
+    const char *runtimeDirectory("RUNTIME_DIRECTORY");
+    if (!qEnvironmentVariableIsEmpty(runtimeDirectory))
+        m_directory = qEnvironmentVariable(runtimeDirectory).split(QLatin1Char(':')).first();
+
+    m_checkTimer.setInterval(CheckInterval);
+    connect(&m_checkTimer, &QTimer::timeout, this, &ConfigDirectChannels::checkChannels);
+}
+
+ConfigDirectChannels::~ConfigDirectChannels()
+{
+    closeAll();
+}
+
+bool ConfigDirectChannels::isAvailable() const
+{
+    return !m_directory.isEmpty();
+}
+
+/*!
+ \brief 打开一个直连通道
+ \a credentials 调用者的凭据，通道的对端以此身份访问配置
+ \a errorMsg 失败时的错误信息
+ \return 通道的地址，失败时返回空
+ */
+QString ConfigDirectChannels::open(const PeerCredentials &credentials, QString &errorMsg)
+{
+    if (!isAvailable()) {
+        errorMsg = QString("The direct channel is unavailable.");
+        return QString();
+    }
+    if (m_channels.size() >= MaxChannelCount) {
+        errorMsg = QString("Too many direct channels, count:%1.").arg(m_channels.size());
+        return QString();
+    }
+
+    // the random name is the capability to connect.
+    Channel channel;
+    channel.socketPath = QString("%1/%2").arg(m_directory, QUuid::createUuid().toString(QUuid::Id128));
+    channel.server = new QDBusServer(QString("unix:path=%1").arg(channel.socketPath), this);
+    if (!channel.server->isConnected()) {
+        errorMsg = QString("Can't listen on the direct channel, %1.").arg(channel.server->lastError().message());
+        delete channel.server;
+        return QString();
+    }
+    // the peer may be other user than the daemon, it's authorized by its uid when it's connected.
+    QFile::setPermissions(channel.socketPath, QFile::ReadOwner | QFile::WriteOwner | QFile::ReadGroup | QFile::WriteGroup
+                                               | QFile::ReadOther | QFile::WriteOther);
+    channel.credentials = credentials;
+    channel.openedTime.start();
+
+    auto server = channel.server;
+    connect(server, &QDBusServer::newConnection, this, [this, server](const QDBusConnection &connection) {
+        onNewConnection(server, connection);
+    });
+    m_channels << channel;
+    if (!m_checkTimer.isActive())
+        m_checkTimer.start();
+
+    qCInfo(cfLog, "Opened direct channel:%s, uid:%u, pid:%u.", qPrintable(channel.socketPath), credentials.uid, credentials.pid);
+    return server->address();
+}
+
+int ConfigDirectChannels::count() const
+{
+    return m_channels.size();
+}
+
+void ConfigDirectChannels::closeAll()
+{
+    for (const auto &channel : std::as_const(m_channels))
+        close(channel);
+    m_channels.clear();
+    m_checkTimer.stop();
+}
+
+void ConfigDirectChannels::onNewConnection(QDBusServer *server, const QDBusConnection &connection)
+{
+    auto iter = std::find_if(m_channels.begin(), m_channels.end(), [server](const Channel &channel) {
+        return channel.server == server;
+    });
+    // only the first connection is accepted.
+    if (iter == m_channels.end() || !iter->connectionName.isEmpty()) {
+        QDBusConnection::disconnectFromPeer(connection.name());
+        return;
+    }
+    if (auto rawConnection = static_cast<DBusConnection *>(connection.internalPointer()))
+        dbus_connection_set_unix_user_function(rawConnection, allowAnyUnixUser, nullptr, nullptr);
+
+    // the channel is kept for its opener if other user connects to it.
+    uint uid = 0;
+    if (!peerUid(connection, uid) || uid != iter->credentials.uid) {
+        qCWarning(cfLog, "Reject the peer of direct channel:%s, uid:%u, expected uid:%u.",
+                  qPrintable(iter->socketPath), uid, iter->credentials.uid);
+        QDBusConnection::disconnectFromPeer(connection.name());
+        return;
+    }
+
+    iter->connectionName = connection.name();
+    QFile::remove(iter->socketPath);
+
+    const auto &service = PeerCredentialsCache::peerServiceName(connection.name());
+    m_credentials->setPeerCredentials(service, iter->credentials);
+    QDBusConnection bus(connection);
+    bus.registerObject(QStringLiteral("/"), m_root, QDBusConnection::ExportAllSlots);
+    qCInfo(cfLog, "Connected direct channel:%s, uid:%u.", qPrintable(service), iter->credentials.uid);
+}
+
+/*
+  \internal
+
+    \breaf Close channels which are disconnected, or not connected in time.
+*/
+void ConfigDirectChannels::checkChannels()
+{
+    for (auto iter = m_channels.begin(); iter != m_channels.end();) {
+        bool closing = false;
+        if (iter->connectionName.isEmpty()) {
+            closing = iter->openedTime.elapsed() > ConnectTimeout;
+        } else {
+            closing = !QDBusConnection(iter->connectionName).isConnected();
+            if (closing)
+                Q_EMIT closed(PeerCredentialsCache::peerServiceName(iter->connectionName));
+        }
+
+        if (closing) {
+            close(*iter);
+            iter = m_channels.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    if (m_channels.isEmpty())
+        m_checkTimer.stop();
+}
+
+void ConfigDirectChannels::close(const Channel &channel)
+{
+    qCInfo(cfLog, "Close direct channel:%s.", qPrintable(channel.socketPath));
+    if (!channel.connectionName.isEmpty()) {
+        m_credentials->remove(PeerCredentialsCache::peerServiceName(channel.connectionName));
+        QDBusConnection::disconnectFromPeer(channel.connectionName);
+    }
+    QFile::remove(channel.socketPath);
+    channel.server->deleteLater();
+}
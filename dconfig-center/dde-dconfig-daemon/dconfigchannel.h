@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include "dconfigcredentials.h"
+#include <QObject>
+#include <QDBusContext>
+#include <QDBusObjectPath>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QList>
+
+class QDBusServer;
+class DSGConfigServer;
+
+/**
+ * @brief The ConfigDirectChannelRoot class
+ * 直连通道上的根对象，只提供获取配置连接的方法，与系统总线上普通用户可调用的方法一致
+ */
+class ConfigDirectChannelRoot : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.desktopspec.ConfigManager")
+public:
+    explicit ConfigDirectChannelRoot(DSGConfigServer *server, PeerCredentialsCache *credentials, QObject *parent = nullptr);
+
+public Q_SLOTS:
+    QDBusObjectPath acquireManager(const QString &appid, const QString &name, const QString &subpath);
+    QDBusObjectPath acquireManagerV2(const uint &uid, const QString &appid, const QString &name, const QString &subpath);
+
+private:
+    DSGConfigServer *m_server = nullptr;
+    PeerCredentialsCache *m_credentials = nullptr;
+};
+
+/**
+ * @brief The ConfigDirectChannels class
+ * 管理客户端的点对点D-Bus连接，每个通道是运行时目录下一次性使用的套接字，
+ * 只接受一个与打开通道的调用者同一用户的连接，连接后即删除套接字文件，对端使用调用者的凭据。
+ */
+class ConfigDirectChannels : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigDirectChannels(DSGConfigServer *server, PeerCredentialsCache *credentials, QObject *parent = nullptr);
+    virtual ~ConfigDirectChannels() override;
+
+    bool isAvailable() const;
+    QString open(const PeerCredentials &credentials, QString &errorMsg);
+    int count() const;
+    void closeAll();
+
+Q_SIGNALS:
+    // the peer is disconnected, its references should be released.
+    void closed(const ConnServiceName &service);
+
+private Q_SLOTS:
+    void checkChannels();
+
+private:
+    struct Channel {
+        QDBusServer *server = nullptr;
+        QString socketPath;
+        QString connectionName;
+        PeerCredentials credentials;
+        QElapsedTimer openedTime;
+    };
+    void onNewConnection(QDBusServer *server, const QDBusConnection &connection);
+    void close(const Channel &channel);
+
+    QString m_directory;
+    QList<Channel> m_channels;
+    ConfigDirectChannelRoot *m_root = nullptr;
+    PeerCredentialsCache *m_credentials = nullptr;
+    QTimer m_checkTimer;
+};
@@ -5,6 +5,9 @@
 #include "dconfigconn.h"
 #include "helper.hpp"
 #include "dconfigresource.h"
+#include "dconfigcredentials.h"
+#include "dconfigsnapshot.h"
+#include "dconfigstats.h"
 
 #include <DConfigFile>
 
@@ -18,8 +21,16 @@ DCORE_USE_NAMESPACE
 
 DSGConfigConn::DSGConfigConn(const ConnKey &key, QObject *parent)
     : QObject (parent),
-      m_key(key)
+      m_key(key),
+      m_resourceKey(getResourceKey(key)),
+      m_uid(getConnectionKey(key)),
+      m_path(formatDBusObjectPath(key))
 {
+    // every path changing a value visible to this connection emits `valueChanged`.
+    connect(this, &DSGConfigConn::valueChanged, this, &DSGConfigConn::removeCachedValue);
+    // coalesce `valueChanged` emitted in the same event loop iteration into one `valuesChanged`.
+    connect(this, &DSGConfigConn::valueChanged, this, &DSGConfigConn::collectChangedKey);
+    connect(this, &DSGConfigConn::valueChanged, this, &DSGConfigConn::scheduleSnapshotUpdate);
 }
 
 DSGConfigConn::~DSGConfigConn()
@@ -31,14 +42,24 @@ ConnKey DSGConfigConn::key() const
     return m_key;
 }
 
+ResourceKey DSGConfigConn::resourceKey() const
+{
+    return m_resourceKey;
+}
+
+uint DSGConfigConn::uid() const
+{
+    return m_uid;
+}
+
 QString DSGConfigConn::path() const
 {
-    return formatDBusObjectPath(m_key);
+    return m_path;
 }
 
 bool DSGConfigConn::containsWithoutProp(const QString &key) const
 {
-    return keyList().contains(key);
+    return metaItem(key) != nullptr;
 }
 
 void DSGConfigConn::setResource(DSGConfigResource *resource)
@@ -46,6 +67,16 @@ void DSGConfigConn::setResource(DSGConfigResource *resource)
     m_resource = resource;
 }
 
+/*!
+ \brief 清除已解析的配置项值缓存
+ 当描述文件被重新解析或通用配置的可用性发生变化时调用
+ */
+void DSGConfigConn::clearValueCache()
+{
+    m_valueCache.clear();
+    scheduleSnapshotUpdate();
+}
+
 /*!
  \brief 返回配置内容的所有配置项
  \return
@@ -99,7 +130,8 @@ QString DSGConfigConn::name(const QString &key, const QString &locale)
  */
 void DSGConfigConn::release()
 {
-    const QString &service = calledFromDBus() ? message().service() : "test.service";
+    ConfigLatencyTimer timer(m_resource->statistics(), ConfigStatistics::Release);
+    const QString &service = calledFromDBus() ? PeerCredentialsCache::serviceName(connection(), message()) : "test.service";
     qCDebug(cfLog, "Received release request, service:%s, path:%s.", qPrintable(service), qPrintable(m_key));
 
     emit releaseChanged(service);
@@ -112,6 +144,7 @@ void DSGConfigConn::release()
  */
 void DSGConfigConn::setValue(const QString &key, const QDBusVariant &value)
 {
+    ConfigLatencyTimer timer(m_resource->statistics(), ConfigStatistics::SetValue);
     if (!contains(key))
         return;
 
@@ -120,10 +153,16 @@ void DSGConfigConn::setValue(const QString &key, const QDBusVariant &value)
 
     const auto &v = decodeQDBusArgument(value.variant());
     qCDebug(cfLog) << "Set value, key:" << key << ", now value:" << v << ", old value:" << file()->value(key, cache());
+    if (isStoredValue(key, v))
+        return;
+
     if(!file()->setValue(key, v, getAppid(), cache()))
         return;
 
-    if (meta()->flags(key).testFlag(DConfigFile::Global)) {
+    m_resource->appendJournal(m_key, key, v, getAppid());
+    replyAfterJournalSynced();
+
+    if (metaItem(key)->flags.testFlag(DConfigFile::Global)) {
         emit globalValueChanged(key);
     } else {
         emit valueChanged(key);
@@ -132,20 +171,67 @@ void DSGConfigConn::setValue(const QString &key, const QDBusVariant &value)
 
 void DSGConfigConn::reset(const QString &key)
 {
+    ConfigLatencyTimer timer(m_resource->statistics(), ConfigStatistics::Reset);
     if (!contains(key))
         return;
 
+    // resetting is a write, it's checked as `setValue` and `resetAll`.
+    if (!hasPermissionByUid(key))
+        return;
+
     qCDebug(cfLog) << "Reset value, key:" << key << ", old value:" << file()->value(key, cache());
+    if (isStoredValue(key, QVariant()))
+        return;
+
     if(!file()->setValue(key, QVariant(), getAppid(), cache()))
         return;
 
-    if (meta()->flags(key).testFlag(DConfigFile::Global)) {
+    m_resource->appendJournal(m_key, key, QVariant(), getAppid());
+    replyAfterJournalSynced();
+
+    if (metaItem(key)->flags.testFlag(DConfigFile::Global)) {
         emit globalValueChanged(key);
     } else {
         emit valueChanged(key);
     }
 }
 
+/*!
+ \brief 批量设置配置项的值
+ 任一配置项不存在或无权限时，所有配置项均不会被设置，
+ 设置完成后只产生一次同步请求及一次分组的值改变通知。
+ \a values 配置项名称及需要设置的值
+ */
+void DSGConfigConn::setValues(const QVariantMap &values)
+{
+    if (!checkWritable(values.keys()))
+        return;
+
+    QVariantMap decodedValues;
+    for (auto iter = values.begin(); iter != values.end(); ++iter)
+        decodedValues.insert(iter.key(), decodeQDBusArgument(iter.value()));
+
+    qCDebug(cfLog) << "Set values, keys:" << decodedValues.keys();
+    applyValues(decodedValues);
+}
+
+/*!
+ \brief 清除所有配置项的缓存值
+ */
+void DSGConfigConn::resetAll()
+{
+    const auto &keys = keyList();
+    if (!checkWritable(keys))
+        return;
+
+    QVariantMap resetValues;
+    for (const auto &key : keys)
+        resetValues.insert(key, QVariant());
+
+    qCDebug(cfLog) << "Reset all values, keys count:" << keys.size();
+    applyValues(resetValues);
+}
+
 /*!
  \brief 返回指定配置项的值
  \a key 配置项名称
@@ -153,39 +239,14 @@ void DSGConfigConn::reset(const QString &key)
  */
 QDBusVariant DSGConfigConn::value(const QString &key)
 {
+    ConfigLatencyTimer timer(m_resource->statistics(), ConfigStatistics::Value);
     if (!contains(key))
         return QDBusVariant();
 
     if (!hasPermissionByUid(key))
         return QDBusVariant();
 
-    // Try to get value from cache.
-    auto value = file()->cacheValue(cache(), key);
-    if (value.isNull()) {
-        const bool canFallback = m_resource->fallbackToGenericConfig();
-        // Fallback to generic configuration.
-        if (canFallback) {
-            const auto uid = getConnectionKey(m_key);
-            const auto &tmp = m_resource->noAppidFile()->cacheValue(m_resource->noAppidCache(uid), key);
-            if (!tmp.isNull()) {
-                value = tmp;
-                qCDebug(cfLog) << "Get [" << key << "]'s cache value from generic configuration.";
-            }
-        }
-        // Fallback to meta or global configuration.
-        if (value.isNull())
-            value = file()->value(key);
-
-        // Fallback to generic meta configuration.
-        if (value.isNull() && canFallback) {
-            const auto &tmp = m_resource->noAppidFile()->value(key);
-            if (!tmp.isNull()) {
-                value = tmp;
-                qCDebug(cfLog) << "Get [" << key << "]'s meta value from generic configuration.";
-            }
-        }
-    }
-
+    const auto &value = resolveValue(key);
     if (value.isNull()) {
         QString errorMsg = QString("[%1] Requires the value in [%2].").arg(key).arg(getAppid());
         qWarning() << qPrintable(errorMsg);
@@ -199,6 +260,51 @@ QDBusVariant DSGConfigConn::value(const QString &key)
     return QDBusVariant{value};
 }
 
+/*!
+ \brief 批量返回配置项的值
+ \a keys 配置项名称列表,为空时返回所有配置项的值
+ \a errors 获取失败的配置项及其错误信息,单个配置项失败不影响其它配置项
+ \return 配置项名称与值的映射
+ */
+QVariantMap DSGConfigConn::values(const QStringList &keys, QVariantMap &errors)
+{
+    const QStringList &targetKeys = keys.isEmpty() ? keyList() : keys;
+    const auto connectionUid = getConnectionKey(m_key);
+    // caller's uid is requested at most once for the whole batch.
+    bool callerUidResolved = false;
+    bool callerUidValid = false;
+    uint caller = connectionUid;
+
+    QVariantMap result;
+    for (const auto &key : targetKeys) {
+        if (!containsWithoutProp(key)) {
+            errors.insert(key, QString("Non-existent configure item [%1] in [%2].").arg(key).arg(m_key));
+            continue;
+        }
+
+        if (calledFromDBus() && !metaItem(key)->flags.testFlag(DConfigFile::UserPublic)) {
+            if (!callerUidResolved) {
+                callerUidValid = callerUid(caller);
+                callerUidResolved = true;
+            }
+            if (!callerUidValid || caller != connectionUid) {
+                errors.insert(key, QString("No Permission configure item [%1] in [%2].").arg(key).arg(m_key));
+                continue;
+            }
+        }
+
+        const auto &value = resolveValue(key);
+        if (value.isNull()) {
+            errors.insert(key, QString("[%1] Requires the value in [%2].").arg(key).arg(getAppid()));
+            continue;
+        }
+        result.insert(key, value);
+    }
+
+    qCDebug(cfLog) << "Get values count:" << result.size() << ", errors count:" << errors.size();
+    return result;
+}
+
 bool DSGConfigConn::isDefaultValue(const QString &key)
 {
     if (!contains(key))
@@ -222,7 +328,7 @@ QString DSGConfigConn::visibility(const QString &key)
     if (!contains(key))
         return QString();
 
-    return meta()->visibility(key) == DTK_CORE_NAMESPACE::DConfigFile::Private ? QString("private") : QString("public");
+    return metaItem(key)->visibility == DTK_CORE_NAMESPACE::DConfigFile::Private ? QString("private") : QString("public");
 }
 
 QString DSGConfigConn::permissions(const QString &key)
@@ -230,20 +336,55 @@ QString DSGConfigConn::permissions(const QString &key)
     if (!contains(key))
         return QString();
 
-    return meta()->permissions(key) == DTK_CORE_NAMESPACE::DConfigFile::ReadWrite ? QString("readwrite") : QString("readonly");
+    return metaItem(key)->permissions == DTK_CORE_NAMESPACE::DConfigFile::ReadWrite ? QString("readwrite") : QString("readonly");
 }
 
 int DSGConfigConn::flags(const QString &key)
 {
-    return static_cast<int>(meta()->flags(key));
+    return static_cast<int>(m_resource->keyFlags(m_resourceKey, key));
+}
+
+/*!
+ \brief 返回保存所有配置项值的只读共享内存，值改变时共享内存随之更新
+ 只有连接所属的用户可以获取，共享内存失效时需要重新获取
+ \return 共享内存的文件描述符
+ */
+QDBusUnixFileDescriptor DSGConfigConn::valuesSnapshot()
+{
+    uint caller = 0;
+    if (calledFromDBus() && (!callerUid(caller) || caller != m_uid)) {
+        QString errorMsg = QString("[%1] No Permission to get the value snapshot in [%2].").arg(getAppid()).arg(m_key);
+        sendErrorReply(QDBusError::AccessDenied, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return QDBusUnixFileDescriptor();
+    }
+
+    if (!m_snapshot || !m_snapshot->isValid()) {
+        const auto &values = snapshotValues();
+        std::unique_ptr<ConfigValueSnapshot> snapshot(new ConfigValueSnapshot);
+        if (!snapshot->create(ConfigValueSnapshot::requiredCapacity(values)) || !snapshot->publish(values)) {
+            QString errorMsg = QString("Can't create the value snapshot in [%1].").arg(m_key);
+            if (calledFromDBus())
+                sendErrorReply(QDBusError::Failed, errorMsg);
+            qWarning() << qPrintable(errorMsg);
+            return QDBusUnixFileDescriptor();
+        }
+        qCDebug(cfLog) << "Created the value snapshot, capacity:" << snapshot->capacity() << ", path:" << m_key;
+        m_snapshot = std::move(snapshot);
+    }
+    return QDBusUnixFileDescriptor(m_snapshot->fd());
 }
 
 QString DSGConfigConn::getAppid() const
 {
     if (m_appName.isEmpty()) {
         if (calledFromDBus()) {
-            const QString &service = message().service();
-            const_cast<DSGConfigConn *>(this)->m_appName = getProcessNameByPid(connection().interface()->servicePid(service));
+            const QString &service = PeerCredentialsCache::serviceName(connection(), message());
+            if (auto credentials = m_resource->credentialsCache()) {
+                const_cast<DSGConfigConn *>(this)->m_appName = credentials->processName(connection(), service);
+            } else {
+                const_cast<DSGConfigConn *>(this)->m_appName = getProcessNameByPid(connection().interface()->servicePid(service));
+            }
         } else {
             const_cast<DSGConfigConn *>(this)->m_appName = QString("testappid");
         }
@@ -271,8 +412,7 @@ DConfigMeta *DSGConfigConn::meta() const
 
 DConfigFile *DSGConfigConn::file() const
 {
-    const auto &resourceKey = getResourceKey(m_key);
-    return m_resource->getFile(resourceKey);
+    return m_resource->getFile(m_resourceKey);
 }
 
 DConfigCache *DSGConfigConn::cache() const
@@ -282,17 +422,15 @@ DConfigCache *DSGConfigConn::cache() const
 
 bool DSGConfigConn::hasPermissionByUid(const QString &key) const
 {
-    auto flags = meta()->flags(key);
-    if (flags.testFlag(DConfigFile::UserPublic))
+    if (metaItem(key)->flags.testFlag(DConfigFile::UserPublic))
         return true;
 
     if (!calledFromDBus())
         return true;
 
-    const QString &service = message().service();
-    const uint callerUid = connection().interface()->serviceUid(service);
     const auto connectionUid = getConnectionKey(m_key);
-    bool hasPermission = callerUid == connectionUid;
+    uint caller = 0;
+    bool hasPermission = callerUid(caller) && caller == connectionUid;
 
     if (!hasPermission) {
         QString errorMsg = QString("[%1] No Permission configure item [%2] in [%3].").arg(getAppid()).arg(key).arg(m_key);
@@ -301,3 +439,257 @@ bool DSGConfigConn::hasPermissionByUid(const QString &key) const
     }
     return hasPermission;
 }
+
+/*!
+ \internal
+ \brief 检查所有配置项是否存在且调用者有权限修改，调用者的uid只获取一次
+ \a keys 配置项名称列表
+ \return 任一配置项检查失败时返回false，并回复错误信息
+ */
+bool DSGConfigConn::checkWritable(const QStringList &keys)
+{
+    const auto connectionUid = getConnectionKey(m_key);
+    bool callerUidResolved = false;
+    bool callerUidValid = false;
+    uint caller = connectionUid;
+
+    QStringList nonExistentKeys;
+    QStringList deniedKeys;
+    for (const auto &key : keys) {
+        if (!containsWithoutProp(key)) {
+            nonExistentKeys << key;
+            continue;
+        }
+
+        if (calledFromDBus() && !metaItem(key)->flags.testFlag(DConfigFile::UserPublic)) {
+            if (!callerUidResolved) {
+                callerUidValid = callerUid(caller);
+                callerUidResolved = true;
+            }
+            if (!callerUidValid || caller != connectionUid)
+                deniedKeys << key;
+        }
+    }
+
+    if (!nonExistentKeys.isEmpty()) {
+        QString errorMsg = QString("[%1] Requires Non-existent configure items [%2] in [%3].").arg(getAppid()).arg(nonExistentKeys.join(",")).arg(m_key);
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::Failed, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return false;
+    }
+
+    if (!deniedKeys.isEmpty()) {
+        QString errorMsg = QString("[%1] No Permission configure items [%2] in [%3].").arg(getAppid()).arg(deniedKeys.join(",")).arg(m_key);
+        sendErrorReply(QDBusError::AccessDenied, errorMsg);
+        qWarning() << qPrintable(errorMsg);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ \internal
+ \brief 设置多个配置项的值，值为无效值时清除缓存值，并以一次分组信号通知值的改变
+ \a values 已检查过的配置项名称及需要设置的值
+ */
+void DSGConfigConn::applyValues(const QVariantMap &values)
+{
+    const auto &appid = getAppid();
+    QStringList changedKeys;
+    for (auto iter = values.begin(); iter != values.end(); ++iter) {
+        if (isStoredValue(iter.key(), iter.value()))
+            continue;
+
+        if (file()->setValue(iter.key(), iter.value(), appid, cache())) {
+            m_resource->appendJournal(m_key, iter.key(), iter.value(), appid);
+            changedKeys << iter.key();
+        }
+    }
+
+    if (!changedKeys.isEmpty()) {
+        replyAfterJournalSynced();
+        emit batchValueChanged(changedKeys);
+    }
+}
+
+/*!
+ \internal
+ \brief 修改记录同步到磁盘后再回复调用者，同一事件循环中多个调用的记录一起同步
+ */
+void DSGConfigConn::replyAfterJournalSynced()
+{
+    if (!calledFromDBus())
+        return;
+
+    if (m_resource->replyAfterJournalSynced(connection(), message()))
+        setDelayedReply(true);
+}
+
+/*!
+ \internal
+ \brief 缓存中已经是此值，或者重置时缓存中没有值，写入不会改变任何内容
+ \a key 配置项名称
+ \a value 需要写入的值，无效值表示重置
+ */
+bool DSGConfigConn::isStoredValue(const QString &key, const QVariant &value) const
+{
+    const auto &cached = file()->cacheValue(cache(), key);
+    if (!value.isValid())
+        return cached.isNull();
+
+    return !cached.isNull() && cached == value;
+}
+
+void DSGConfigConn::removeCachedValue(const QString &key)
+{
+    m_valueCache.remove(key);
+}
+
+/*!
+ \internal
+ \brief 收集改变的配置项，在本次事件循环结束时统一发送`valuesChanged`信号
+ \a key 配置项名称
+ */
+void DSGConfigConn::collectChangedKey(const QString &key)
+{
+    const bool needFlush = m_pendingChangedKeys.isEmpty();
+    m_pendingChangedKeys.insert(key);
+    if (needFlush)
+        QMetaObject::invokeMethod(this, &DSGConfigConn::flushChangedKeys, Qt::QueuedConnection);
+}
+
+void DSGConfigConn::flushChangedKeys()
+{
+    if (m_pendingChangedKeys.isEmpty())
+        return;
+
+    const QStringList keys(m_pendingChangedKeys.begin(), m_pendingChangedKeys.end());
+    m_pendingChangedKeys.clear();
+    qCDebug(cfLog) << "Values changed, keys count:" << keys.size() << ", path:" << m_key;
+    emit valuesChanged(keys);
+}
+
+/*!
+ \internal
+ \brief 值改变后在本次事件循环结束时更新共享内存，多次改变只更新一次
+ */
+void DSGConfigConn::scheduleSnapshotUpdate()
+{
+    if (!m_snapshot || m_snapshotUpdatePending)
+        return;
+
+    m_snapshotUpdatePending = true;
+    QMetaObject::invokeMethod(this, &DSGConfigConn::updateSnapshot, Qt::QueuedConnection);
+}
+
+void DSGConfigConn::updateSnapshot()
+{
+    m_snapshotUpdatePending = false;
+    if (!m_snapshot)
+        return;
+
+    // it's invalidated when the values outgrow it, the client requests a larger one.
+    if (!m_snapshot->publish(snapshotValues()))
+        m_snapshot.reset();
+}
+
+/*!
+ \internal
+ \brief 从描述文件的索引中获取配置项信息
+ \a key 配置项名称
+ \return 配置项不存在时返回空指针
+ */
+const ConfigMetaItem *DSGConfigConn::metaItem(const QString &key) const
+{
+    if (auto index = m_resource->metaIndex(m_resourceKey)) {
+        auto iter = index->constFind(key);
+        if (iter != index->constEnd())
+            return &iter.value();
+    }
+    return nullptr;
+}
+
+/*!
+ \internal
+ \brief 获取调用者的用户ID
+ \a uid 调用者的用户ID
+ \return 是否获取成功，失败时调用者没有任何用户的权限
+ */
+bool DSGConfigConn::callerUid(uint &uid) const
+{
+    const QString &service = PeerCredentialsCache::serviceName(connection(), message());
+    if (auto credentials = m_resource->credentialsCache())
+        return credentials->uid(connection(), service, uid);
+
+    auto interface = connection().interface();
+    if (!interface)
+        return false;
+
+    const auto &reply = interface->serviceUid(service);
+    if (!reply.isValid())
+        return false;
+
+    uid = reply.value();
+    return true;
+}
+
+/*!
+ \internal
+ \brief 按照用户缓存、通用配置缓存、描述文件、通用描述文件的顺序获取配置项的值
+ \a key 配置项名称
+ \return 未获取到时返回无效值
+ */
+QVariant DSGConfigConn::resolveValue(const QString &key) const
+{
+    auto iter = m_valueCache.constFind(key);
+    if (iter != m_valueCache.constEnd())
+        return iter.value();
+
+    // Try to get value from cache.
+    auto value = file()->cacheValue(cache(), key);
+    if (value.isNull()) {
+        const bool canFallback = m_resource->fallbackToGenericConfig();
+        // Fallback to generic configuration.
+        if (canFallback) {
+            const auto uid = getConnectionKey(m_key);
+            const auto &tmp = m_resource->noAppidFile()->cacheValue(m_resource->noAppidCache(uid), key);
+            if (!tmp.isNull()) {
+                value = tmp;
+                qCDebug(cfLog) << "Get [" << key << "]'s cache value from generic configuration.";
+            }
+        }
+        // Fallback to meta or global configuration.
+        if (value.isNull())
+            value = file()->value(key);
+
+        // Fallback to generic meta configuration.
+        if (value.isNull() && canFallback) {
+            const auto &tmp = m_resource->noAppidFile()->value(key);
+            if (!tmp.isNull()) {
+                value = tmp;
+                qCDebug(cfLog) << "Get [" << key << "]'s meta value from generic configuration.";
+            }
+        }
+    }
+
+    if (!value.isNull())
+        m_valueCache.insert(key, value);
+
+    return value;
+}
+
+/*!
+ \internal
+ \brief 获取所有有值的配置项，用于发布到共享内存
+ */
+QVariantMap DSGConfigConn::snapshotValues() const
+{
+    QVariantMap values;
+    for (const auto &key : keyList()) {
+        const auto &value = resolveValue(key);
+        if (!value.isNull())
+            values.insert(key, value);
+    }
+    return values;
+}
@@ -9,6 +9,10 @@
 #include <QObject>
 #include <QDBusObjectPath>
 #include <QDBusContext>
+#include <QDBusUnixFileDescriptor>
+#include <QHash>
+#include <QSet>
+#include <memory>
 
 DCORE_BEGIN_NAMESPACE
 class DConfigFile;
@@ -22,6 +26,8 @@ DCORE_END_NAMESPACE
  * 配置文件的解析及方法调用
  */
 class DSGConfigResource;
+struct ConfigMetaItem;
+class ConfigValueSnapshot;
 class DSGConfigConn : public QObject, protected QDBusContext
 {
     Q_OBJECT
@@ -31,12 +37,16 @@ public:
     virtual ~DSGConfigConn() override;
 
     ConnKey key() const;
+    ResourceKey resourceKey() const;
+    uint uid() const;
     QString path() const;
     bool containsWithoutProp(const QString &key) const;
 
     void setResource(DSGConfigResource *resource);
+    void clearValueCache();
 Q_SIGNALS:
     void releaseChanged(const ConnServiceName &service);
+    void batchValueChanged(const QStringList &keys);
 
 public: // PROPERTIES
     Q_PROPERTY(QStringList keyList READ keyList)
@@ -51,26 +61,55 @@ public Q_SLOTS: // METHODS
     void release();
     void setValue(const QString &key, const QDBusVariant &value);
     void reset(const QString &key);
+    void setValues(const QVariantMap &values);
+    void resetAll();
     QDBusVariant value(const QString &key);
+    QVariantMap values(const QStringList &keys, QVariantMap &errors);
     bool isDefaultValue(const QString &key);
     QString visibility(const QString &key) ;
     QString permissions(const QString &key) ;
     int flags(const QString &key);
+    QDBusUnixFileDescriptor valuesSnapshot();
 Q_SIGNALS: // SIGNALS
     void valueChanged(const QString &key);
+    void valuesChanged(const QStringList &keys);
     void globalValueChanged(const QString &key);
 
+private Q_SLOTS:
+    void removeCachedValue(const QString &key);
+    void collectChangedKey(const QString &key);
+    void flushChangedKeys();
+    void scheduleSnapshotUpdate();
+    void updateSnapshot();
+
 private:
     QString getAppid() const;
     bool contains(const QString &key);
     DTK_CORE_NAMESPACE::DConfigMeta *meta() const;
     DTK_CORE_NAMESPACE::DConfigFile *file() const;
     DTK_CORE_NAMESPACE::DConfigCache *cache() const;
+    const ConfigMetaItem *metaItem(const QString &key) const;
     bool hasPermissionByUid(const QString &key) const;
+    bool callerUid(uint &uid) const;
+    bool checkWritable(const QStringList &keys);
+    void applyValues(const QVariantMap &values);
+    void replyAfterJournalSynced();
+    bool isStoredValue(const QString &key, const QVariant &value) const;
+    QVariant resolveValue(const QString &key) const;
+    QVariantMap snapshotValues() const;
 
 private:
     ConnKey m_key;
+    ResourceKey m_resourceKey;
+    uint m_uid = 0;
+    QString m_path;
     DSGConfigResource *m_resource = nullptr;
     QString m_appName;
+    QSet<QString> m_pendingChangedKeys;
+    // key -> value resolved by the fallback chain, dropped when `valueChanged` is emitted.
+    mutable QHash<QString, QVariant> m_valueCache;
+    // shared memory of the resolved values, created when requested by the client.
+    std::unique_ptr<ConfigValueSnapshot> m_snapshot;
+    bool m_snapshotUpdatePending = false;
 };
 
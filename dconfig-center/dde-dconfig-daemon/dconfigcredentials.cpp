@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigcredentials.h"
+
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+#include <QDBusReply>
+#include <QDBusServiceWatcher>
+#include <QDebug>
+
+PeerCredentialsCache::PeerCredentialsCache(QObject *parent)
+    : QObject(parent)
+{
+}
+
+PeerCredentialsCache::~PeerCredentialsCache()
+{
+    clear();
+}
+
+/*!
+ \brief 获取调用者的用户ID
+ \a uid 调用者的用户ID
+ \return 是否获取成功，调用者已断开时失败，此时不能以默认值作为调用者的身份
+ */
+bool PeerCredentialsCache::uid(const QDBusConnection &connection, const ConnServiceName &service, uint &uid)
+{
+    auto item = find(connection, service);
+    if (!item)
+        return false;
+
+    uid = item->uid;
+    return true;
+}
+
+/*!
+ \brief 获取调用者的用户ID、进程ID及进程名称
+ \return 是否获取成功
+ */
+bool PeerCredentialsCache::credentials(const QDBusConnection &connection, const ConnServiceName &service, PeerCredentials &credentials)
+{
+    auto item = find(connection, service);
+    if (!item)
+        return false;
+
+    if (item->processName.isEmpty())
+        item->processName = getProcessNameByPid(item->pid);
+
+    credentials = *item;
+    return true;
+}
+
+/*!
+ \brief 获取调用者的进程名称，获取失败时返回空
+ */
+QString PeerCredentialsCache::processName(const QDBusConnection &connection, const ConnServiceName &service)
+{
+    PeerCredentials item;
+    return credentials(connection, service, item) ? item.processName : QString();
+}
+
+/*!
+ \brief 设置直连通道对端的凭据，对端没有总线名称，无法从总线守护进程获取
+ \a service 对端的名称
+ \a credentials 打开通道的调用者的凭据
+ */
+void PeerCredentialsCache::setPeerCredentials(const ConnServiceName &service, const PeerCredentials &credentials)
+{
+    m_credentials.insert(service, credentials);
+}
+
+void PeerCredentialsCache::remove(const ConnServiceName &service)
+{
+    if (m_credentials.remove(service) > 0) {
+        qCDebug(cfLog, "Remove credentials of the service:%s, remaining %d.", qPrintable(service), m_credentials.size());
+    }
+    if (m_watcher)
+        m_watcher->removeWatchedService(service);
+}
+
+void PeerCredentialsCache::clear()
+{
+    m_credentials.clear();
+    if (m_watcher)
+        m_watcher->setWatchedServices({});
+}
+
+int PeerCredentialsCache::size() const
+{
+    return m_credentials.size();
+}
+
+/*!
+ \brief 获取消息发送者的名称，直连通道的消息没有发送者，以连接名称区分
+ */
+ConnServiceName PeerCredentialsCache::serviceName(const QDBusConnection &connection, const QDBusMessage &message)
+{
+    const auto &service = message.service();
+    return service.isEmpty() ? peerServiceName(connection.name()) : service;
+}
+
+ConnServiceName PeerCredentialsCache::peerServiceName(const QString &connectionName)
+{
+    return QStringLiteral("peer:") + connectionName;
+}
+
+bool PeerCredentialsCache::isPeerService(const ConnServiceName &service)
+{
+    return service.startsWith(QLatin1String("peer:"));
+}
+
+/*
+  \internal
+
+    \breaf Get the cached credentials or request them from the bus daemon, it's null if failed.
+    the service is watched before requesting, the unregistration is emitted if it exits after
+    the request succeeds, and it's not watched or cached if the request fails, e.g. it's exited.
+*/
+PeerCredentials *PeerCredentialsCache::find(const QDBusConnection &connection, const ConnServiceName &service)
+{
+    auto iter = m_credentials.find(service);
+    if (iter != m_credentials.end())
+        return &iter.value();
+
+    // the peer of the direct channel has no bus daemon, its credentials are only set by the channel.
+    if (isPeerService(service))
+        return nullptr;
+
+    if (!m_watcher) {
+        m_watcher = new QDBusServiceWatcher(this);
+        m_watcher->setConnection(connection);
+        m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+        connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, this, &PeerCredentialsCache::remove);
+    }
+    m_watcher->addWatchedService(service);
+
+    PeerCredentials credentials;
+    if (!requestCredentials(connection, service, credentials)) {
+        qCWarning(cfLog) << "Failed to get the credentials of the service:" << service;
+        m_watcher->removeWatchedService(service);
+        return nullptr;
+    }
+    return &m_credentials.insert(service, credentials).value();
+}
+
+/*!
+ \internal
+ \brief 通过一次`GetConnectionCredentials`调用获取调用者的用户ID及进程ID，
+ 总线不支持时使用`GetConnectionUnixUser`及`GetConnectionUnixProcessID`。
+ \return 是否获取成功
+ */
+bool PeerCredentialsCache::requestCredentials(const QDBusConnection &connection, const ConnServiceName &service, PeerCredentials &result)
+{
+    if (!connection.isConnected())
+        return false;
+
+    auto message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.DBus"),
+                                                  QStringLiteral("/org/freedesktop/DBus"),
+                                                  QStringLiteral("org.freedesktop.DBus"),
+                                                  QStringLiteral("GetConnectionCredentials"));
+    message << service;
+    const QDBusReply<QVariantMap> reply = connection.call(message);
+    if (reply.isValid()) {
+        const auto &credentials = reply.value();
+        const auto uid = credentials.value(QStringLiteral("UnixUserID"));
+        const auto pid = credentials.value(QStringLiteral("ProcessID"));
+        if (uid.isValid() && pid.isValid()) {
+            result.uid = uid.toUInt();
+            result.pid = pid.toUInt();
+            return true;
+        }
+    }
+
+    auto interface = connection.interface();
+    if (!interface)
+        return false;
+
+    qCDebug(cfLog) << "Fallback to request uid and pid separately for the service:" << service << reply.error().message();
+    const auto &uid = interface->serviceUid(service);
+    const auto &pid = interface->servicePid(service);
+    if (!uid.isValid() || !pid.isValid())
+        return false;
+
+    result.uid = uid.value();
+    result.pid = pid.value();
+    return true;
+}
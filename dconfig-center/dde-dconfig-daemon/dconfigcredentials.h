@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <QObject>
+#include <QHash>
+#include <QDBusConnection>
+
+class QDBusServiceWatcher;
+class QDBusMessage;
+
+struct PeerCredentials
+{
+    uint uid = 0;
+    uint pid = 0;
+    // read from `/proc/<pid>/cmdline` on first use.
+    QString processName;
+};
+
+/**
+ * @brief The PeerCredentialsCache class
+ * 缓存调用者的用户ID、进程ID及进程名称，以唯一总线名称为键，
+ * 每个调用者只请求一次总线守护进程，调用者断开时移除，获取失败时不缓存。
+ */
+class PeerCredentialsCache : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PeerCredentialsCache(QObject *parent = nullptr);
+    virtual ~PeerCredentialsCache() override;
+
+    bool uid(const QDBusConnection &connection, const ConnServiceName &service, uint &uid);
+    bool credentials(const QDBusConnection &connection, const ConnServiceName &service, PeerCredentials &credentials);
+    QString processName(const QDBusConnection &connection, const ConnServiceName &service);
+
+    void setPeerCredentials(const ConnServiceName &service, const PeerCredentials &credentials);
+    void remove(const ConnServiceName &service);
+    void clear();
+    int size() const;
+
+    static ConnServiceName serviceName(const QDBusConnection &connection, const QDBusMessage &message);
+    static ConnServiceName peerServiceName(const QString &connectionName);
+    static bool isPeerService(const ConnServiceName &service);
+
+private:
+    PeerCredentials *find(const QDBusConnection &connection, const ConnServiceName &service);
+    static bool requestCredentials(const QDBusConnection &connection, const ConnServiceName &service, PeerCredentials &result);
+
+    QHash<ConnServiceName, PeerCredentials> m_credentials;
+    QDBusServiceWatcher *m_watcher = nullptr;
+};
@@ -0,0 +1,150 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigdependency.h"
+
+#include <QFileInfo>
+#include <QDebug>
+
+// resource name of the generic key `/name/subpath`.
+static QString resourceName(const GenericResourceKey &key)
+{
+    return key.section(QLatin1Char('/'), 1, 1);
+}
+
+// subpath starts with `/`, it's empty for the root.
+static QString normalizedSubpath(const QString &subpath)
+{
+    QString result = subpath;
+    while (result.endsWith(QLatin1Char('/')))
+        result.chop(1);
+    if (!result.isEmpty() && !result.startsWith(QLatin1Char('/')))
+        result.prepend(QLatin1Char('/'));
+    return result;
+}
+
+ConfigDependencyGraph::ConfigDependencyGraph(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/*!
+ \brief 添加已加载的配置文件
+ \a key 配置文件的资源键
+ \a metaPath 解析时使用的描述文件路径
+ */
+void ConfigDependencyGraph::addFile(const ResourceKey &key, const QString &metaPath)
+{
+    auto item = node(key);
+    item.metaPath = metaPath.isEmpty() ? QString() : QFileInfo(metaPath).absoluteFilePath();
+    m_nodes.insert(key, item);
+    m_files[resourceName(getGenericResourceKeyByResourceKey(key))].insert(key);
+}
+
+void ConfigDependencyGraph::removeFile(const ResourceKey &key)
+{
+    if (!m_nodes.remove(key))
+        return;
+
+    const auto &name = resourceName(getGenericResourceKeyByResourceKey(key));
+    auto iter = m_files.find(name);
+    if (iter == m_files.end())
+        return;
+
+    iter->remove(key);
+    if (iter->isEmpty())
+        m_files.erase(iter);
+}
+
+bool ConfigDependencyGraph::contains(const ResourceKey &key) const
+{
+    return m_nodes.contains(key);
+}
+
+int ConfigDependencyGraph::size() const
+{
+    return m_nodes.size();
+}
+
+/*!
+ \brief 获取受描述文件或覆盖文件变化影响的已加载配置文件
+ 覆盖文件影响同一应用（或所有应用）及其子目录的配置文件；描述文件影响正在使用它的配置文件，
+ 以及可能因它新增而改用它的配置文件。
+ \a path 变化的描述文件或覆盖文件路径
+ */
+QList<ResourceKey> ConfigDependencyGraph::affectedFiles(const QString &path) const
+{
+    const auto &absolutePath = QFileInfo(path).absoluteFilePath();
+    const auto &meta = getMetaConfigureId(absolutePath);
+    const bool isOverride = meta.isInValid();
+    const auto &source = isOverride ? getOverrideConfigureId(absolutePath) : meta;
+    if (source.isInValid())
+        return {};
+
+    QList<ResourceKey> result;
+    const auto &keys = m_files.value(source.resource);
+    for (const auto &key : keys) {
+        const auto &item = m_nodes[key];
+        if (!dependsOn(source, item))
+            continue;
+
+        if (isOverride || item.metaPath == absolutePath) {
+            result << key;
+            continue;
+        }
+
+        // a more specific meta than the used one may be added.
+        const auto &used = getMetaConfigureId(item.metaPath);
+        const bool moreSpecific = (!source.appid.isEmpty() && used.appid.isEmpty())
+                || (source.appid == used.appid && normalizedSubpath(source.subpath).size() > normalizedSubpath(used.subpath).size());
+        if (used.isInValid() || moreSpecific)
+            result << key;
+    }
+    return result;
+}
+
+/*!
+ \brief 获取可能使用指定描述文件或覆盖文件的所有已加载配置文件
+ */
+QList<ResourceKey> ConfigDependencyGraph::dependentFiles(const ConfigureId &source) const
+{
+    QList<ResourceKey> result;
+    const auto &keys = m_files.value(source.resource);
+    for (const auto &key : keys) {
+        if (dependsOn(source, m_nodes[key]))
+            result << key;
+    }
+    return result;
+}
+
+/*!
+ \brief 配置文件是否可能使用指定的描述文件或覆盖文件，通用配置影响所有应用，上级子目录影响下级子目录
+ \a source 描述文件或覆盖文件的配置标识
+ \a key 配置文件的资源键
+ */
+bool ConfigDependencyGraph::dependsOn(const ConfigureId &source, const ResourceKey &key)
+{
+    if (resourceName(getGenericResourceKeyByResourceKey(key)) != source.resource)
+        return false;
+
+    return dependsOn(source, node(key));
+}
+
+bool ConfigDependencyGraph::dependsOn(const ConfigureId &source, const Node &node)
+{
+    if (!source.appid.isEmpty() && outerAppidToInner(source.appid) != node.appid)
+        return false;
+
+    const auto &subpath = normalizedSubpath(source.subpath);
+    return subpath.isEmpty() || node.subpath == subpath || node.subpath.startsWith(subpath + QLatin1Char('/'));
+}
+
+ConfigDependencyGraph::Node ConfigDependencyGraph::node(const ResourceKey &key)
+{
+    const auto &genericKey = getGenericResourceKeyByResourceKey(key);
+    Node item;
+    item.appid = getAppidByResourceKey(key);
+    item.subpath = normalizedSubpath(genericKey.mid(resourceName(genericKey).size() + 1));
+    return item;
+}
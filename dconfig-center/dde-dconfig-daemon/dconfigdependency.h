@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <QObject>
+#include <QHash>
+#include <QSet>
+
+/**
+ * @brief The ConfigDependencyGraph class
+ * 记录已加载的配置文件依赖的描述文件及覆盖文件，描述文件或覆盖文件变化时，
+ * 一次找出所有受影响的配置文件，包括使用通用描述文件的应用及子目录中的配置文件。
+ */
+class ConfigDependencyGraph : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigDependencyGraph(QObject *parent = nullptr);
+
+    void addFile(const ResourceKey &key, const QString &metaPath);
+    void removeFile(const ResourceKey &key);
+    bool contains(const ResourceKey &key) const;
+    int size() const;
+
+    QList<ResourceKey> affectedFiles(const QString &path) const;
+    QList<ResourceKey> dependentFiles(const ConfigureId &source) const;
+    static bool dependsOn(const ConfigureId &source, const ResourceKey &key);
+
+private:
+    struct Node {
+        QString appid; // inner appid
+        QString subpath;
+        // the meta file used when the file is parsed.
+        QString metaPath;
+    };
+    static Node node(const ResourceKey &key);
+    static bool dependsOn(const ConfigureId &source, const Node &node);
+
+    QHash<ResourceKey, Node> m_nodes;
+    // resource name -> loaded files of all applications and subpaths.
+    QHash<QString, QSet<ResourceKey>> m_files;
+};
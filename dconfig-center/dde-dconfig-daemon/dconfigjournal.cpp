@@ -0,0 +1,301 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigjournal.h"
+#include "dconfig_global.h"
+
+#include <QDataStream>
+#include <QDBusConnection>
+#include <QDir>
+#include <QDebug>
+
+#include <unistd.h>
+
+static const QString JournalSegmentPrefix("journal-");
+static const QString JournalSegmentSuffix(".log");
+static constexpr int JournalSegmentSequenceWidth = 16;
+static constexpr QDataStream::Version JournalStreamVersion = QDataStream::Qt_5_11;
+
+ConfigJournal::ConfigJournal(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ConfigJournal::~ConfigJournal()
+{
+    close();
+}
+
+/*!
+ \brief 在指定目录中打开新的日志段，目录中已存在的日志段应在此之前重放
+ \a directory 日志目录
+ \return 是否打开成功
+ */
+bool ConfigJournal::open(const QString &directory)
+{
+    close();
+
+    if (!QDir().mkpath(directory)) {
+        qCWarning(cfLog) << "Failed to create journal directory:" << directory;
+        return false;
+    }
+    m_directory = directory;
+    m_unsavedIds.clear();
+    m_sealedSegments.clear();
+
+    m_sequence = 0;
+    const auto &existing = segments(directory);
+    if (!existing.isEmpty()) {
+        const auto &name = QFileInfo(existing.last()).completeBaseName();
+        m_sequence = name.mid(JournalSegmentPrefix.size()).toLongLong();
+    }
+    return openSegment();
+}
+
+void ConfigJournal::close()
+{
+    if (!m_file.isOpen())
+        return;
+
+    sync();
+    m_file.close();
+    // nothing is appended after opened.
+    if (m_file.size() <= 0)
+        m_file.remove();
+}
+
+bool ConfigJournal::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+/*!
+ \brief 追加一条记录，立即写入文件，在本次事件循环结束时统一同步到磁盘
+ \a record 配置项修改记录
+ \a objectId 被修改对象的ID，如用户缓存的连接键或全局缓存的资源键，该对象保存后记录不再需要
+ */
+void ConfigJournal::append(const ConfigJournalRecord &record, const QString &objectId)
+{
+    if (!m_file.isOpen())
+        return;
+
+    m_unsavedIds.insert(objectId);
+
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(JournalStreamVersion);
+        stream << record.appid << record.name << record.subpath << record.uid
+               << record.key << record.value << record.callerAppid;
+    }
+    QDataStream stream(&m_file);
+    stream.setVersion(JournalStreamVersion);
+    stream << payload;
+    m_file.flush();
+
+    if (!m_syncPending) {
+        m_syncPending = true;
+        QMetaObject::invokeMethod(this, &ConfigJournal::sync, Qt::QueuedConnection);
+    }
+}
+
+/*!
+ \brief 在已追加的记录同步到磁盘后回复调用者，同一事件循环中的调用一起同步
+ \a connection 调用者所在的连接
+ \a message 调用消息
+ \return 日志未打开时返回false，调用者应直接回复
+ */
+bool ConfigJournal::replyAfterSync(const QDBusConnection &connection, const QDBusMessage &message)
+{
+    if (!m_file.isOpen())
+        return false;
+
+    if (message.isReplyRequired())
+        m_pendingReplies << qMakePair(connection.name(), message);
+
+    if (!m_syncPending) {
+        m_syncPending = true;
+        QMetaObject::invokeMethod(this, &ConfigJournal::sync, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+/*!
+ \brief 对象已生成保存快照，之前追加的该对象的记录不再需要
+ \a objectId 被保存对象的ID
+ */
+void ConfigJournal::markSaved(const QString &objectId)
+{
+    m_unsavedIds.remove(objectId);
+    for (auto &segment : m_sealedSegments)
+        segment.unsavedIds.remove(objectId);
+}
+
+/*!
+ \brief 对象的保存快照写入失败，所有未删除的日志段都需要保留到该对象再次保存
+ \a objectId 写入失败对象的ID
+ */
+void ConfigJournal::markUnsaved(const QString &objectId)
+{
+    if (m_file.isOpen())
+        m_unsavedIds.insert(objectId);
+    for (auto &segment : m_sealedSegments) {
+        segment.unsavedIds.insert(objectId);
+        segment.checkpoint = 0;
+        segment.confirmed = false;
+    }
+}
+
+/*!
+ \brief 封存当前日志段并打开新的日志段
+ \return 被封存的日志段路径，当前日志段为空时返回空
+ */
+QString ConfigJournal::seal()
+{
+    if (!m_file.isOpen() || m_file.size() <= 0)
+        return QString();
+
+    const QString path = m_file.fileName();
+    close();
+    openSegment();
+    SealedSegment segment;
+    segment.path = path;
+    segment.unsavedIds = m_unsavedIds;
+    m_sealedSegments << segment;
+    m_unsavedIds.clear();
+    return path;
+}
+
+/*!
+ \brief 从最早的日志段开始取出记录修改的对象都已保存的封存日志段，作为新的检查点，
+ 它们在之前提交的快照都写入后可以删除，较新的日志段不会先于较早的日志段删除
+ \return 新取出的日志段，为空时不创建检查点
+ */
+QStringList ConfigJournal::takeCheckpointedSegments()
+{
+    QStringList result;
+    for (auto &segment : m_sealedSegments) {
+        if (!segment.unsavedIds.isEmpty())
+            break;
+        if (segment.checkpoint > 0)
+            continue;
+
+        if (result.isEmpty())
+            ++m_checkpoint;
+        segment.checkpoint = m_checkpoint;
+        result << segment.path;
+    }
+    return result;
+}
+
+/*!
+ \brief 获取最近一次取出日志段创建的检查点
+ */
+qint64 ConfigJournal::lastCheckpoint() const
+{
+    return m_checkpoint;
+}
+
+/*!
+ \brief 检查点之前提交的快照都已写入，且写入失败的对象已标记为未保存
+ \a checkpoint 检查点
+ \return 可以删除的日志段，它们不再被跟踪
+ */
+QStringList ConfigJournal::confirmCheckpoint(qint64 checkpoint)
+{
+    for (auto &segment : m_sealedSegments) {
+        if (segment.checkpoint == checkpoint)
+            segment.confirmed = true;
+    }
+
+    QStringList result;
+    while (!m_sealedSegments.isEmpty() && m_sealedSegments.first().confirmed)
+        result << m_sealedSegments.takeFirst().path;
+
+    return result;
+}
+
+/*!
+ \brief 获取目录中所有日志段，按写入顺序排列
+ */
+QStringList ConfigJournal::segments(const QString &directory)
+{
+    QStringList result;
+    const QDir dir(directory);
+    const auto &names = dir.entryList({JournalSegmentPrefix + "*" + JournalSegmentSuffix}, QDir::Files, QDir::Name);
+    for (const auto &name : names)
+        result << dir.absoluteFilePath(name);
+
+    return result;
+}
+
+/*!
+ \brief 读取日志段中的记录，末尾不完整的记录被忽略
+ */
+QList<ConfigJournalRecord> ConfigJournal::readSegment(const QString &path)
+{
+    QList<ConfigJournalRecord> result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qCWarning(cfLog) << "Failed to open journal segment:" << path << file.errorString();
+        return result;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(JournalStreamVersion);
+    while (!stream.atEnd()) {
+        QByteArray payload;
+        stream >> payload;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        QDataStream recordStream(payload);
+        recordStream.setVersion(JournalStreamVersion);
+        ConfigJournalRecord record;
+        recordStream >> record.appid >> record.name >> record.subpath >> record.uid
+                     >> record.key >> record.value >> record.callerAppid;
+        if (recordStream.status() != QDataStream::Ok)
+            break;
+
+        result << record;
+    }
+    if (!stream.atEnd())
+        qCWarning(cfLog) << "Ignore the incomplete tail of journal segment:" << path;
+
+    return result;
+}
+
+void ConfigJournal::sync()
+{
+    m_syncPending = false;
+    bool synced = true;
+    if (m_file.isOpen()) {
+        m_file.flush();
+        synced = ::fdatasync(m_file.handle()) == 0;
+        if (!synced)
+            qCWarning(cfLog) << "Failed to sync journal segment:" << m_file.fileName();
+    }
+
+    const auto replies = m_pendingReplies;
+    m_pendingReplies.clear();
+    for (const auto &item : replies) {
+        const auto &reply = synced ? item.second.createReply()
+                                   : item.second.createErrorReply(QDBusError::Failed, "Failed to sync the configuration journal.");
+        QDBusConnection(item.first).send(reply);
+    }
+}
+
+bool ConfigJournal::openSegment()
+{
+    ++m_sequence;
+    const auto &name = QString("%1%2%3").arg(JournalSegmentPrefix)
+            .arg(m_sequence, JournalSegmentSequenceWidth, 10, QLatin1Char('0'))
+            .arg(JournalSegmentSuffix);
+    m_file.setFileName(QDir(m_directory).absoluteFilePath(name));
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qCWarning(cfLog) << "Failed to open journal segment:" << m_file.fileName() << m_file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QFile>
+#include <QSet>
+#include <QVariant>
+#include <QDBusMessage>
+
+class QDBusConnection;
+
+struct ConfigJournalRecord
+{
+    // inner appid.
+    QString appid;
+    QString name;
+    QString subpath;
+    uint uid = 0;
+    QString key;
+    // invalid value means to reset the key.
+    QVariant value;
+    QString callerAppid;
+};
+
+/**
+ * @brief The ConfigJournal class
+ * 预写日志，记录已接受但还未保存的配置项修改，服务异常退出后启动时重放。
+ * 修改记录同步到磁盘后才回复调用者，日志按段存储，段中记录修改的对象都保存后删除该段。
+ */
+class ConfigJournal : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigJournal(QObject *parent = nullptr);
+    virtual ~ConfigJournal() override;
+
+    bool open(const QString &directory);
+    void close();
+    bool isOpen() const;
+
+    void append(const ConfigJournalRecord &record, const QString &objectId);
+    bool replyAfterSync(const QDBusConnection &connection, const QDBusMessage &message);
+    void markSaved(const QString &objectId);
+    void markUnsaved(const QString &objectId);
+    QString seal();
+    QStringList takeCheckpointedSegments();
+    qint64 lastCheckpoint() const;
+    QStringList confirmCheckpoint(qint64 checkpoint);
+
+    static QStringList segments(const QString &directory);
+    static QList<ConfigJournalRecord> readSegment(const QString &path);
+
+private Q_SLOTS:
+    void sync();
+
+private:
+    bool openSegment();
+
+    QString m_directory;
+    QFile m_file;
+    qint64 m_sequence = 0;
+    bool m_syncPending = false;
+    // ids of the objects modified by the records of the current segment, and not saved since.
+    QSet<QString> m_unsavedIds;
+    struct SealedSegment {
+        QString path;
+        // it's checkpointed when no id is left.
+        QSet<QString> unsavedIds;
+        // the checkpoint taking it, 0 if it's not taken.
+        qint64 checkpoint = 0;
+        // the snapshots of the checkpoint are written, it's removed after the older segments.
+        bool confirmed = false;
+    };
+    // in the order of writing.
+    QList<SealedSegment> m_sealedSegments;
+    qint64 m_checkpoint = 0;
+    // connection name -> the call waiting for the records to be synced.
+    QList<QPair<QString, QDBusMessage>> m_pendingReplies;
+};
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigloader.h"
+#include "dconfigwriter.h"
+
+#include <DConfigFile>
+#include <QRunnable>
+#include <QDebug>
+
+#include <functional>
+#include <memory>
+
+DCORE_USE_NAMESPACE
+
+// parsing is mostly blocked on reading files, a few threads are enough.
+static constexpr int DefaultMaxThreadCount = 2;
+
+namespace {
+class ConfigFileLoadJob : public QRunnable
+{
+public:
+    explicit ConfigFileLoadJob(const std::function<void()> &job)
+        : m_job(job)
+    {
+    }
+    void run() override
+    {
+        m_job();
+    }
+
+private:
+    std::function<void()> m_job;
+};
+}
+
+ConfigFileLoader::ConfigFileLoader(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(DefaultMaxThreadCount);
+}
+
+ConfigFileLoader::~ConfigFileLoader()
+{
+    waitForDone();
+}
+
+void ConfigFileLoader::setPersistenceWriter(ConfigPersistenceWriter *writer)
+{
+    m_writer = writer;
+}
+
+int ConfigFileLoader::maxThreadCount() const
+{
+    return m_pool.maxThreadCount();
+}
+
+void ConfigFileLoader::setMaxThreadCount(const int count)
+{
+    m_pool.setMaxThreadCount(count);
+}
+
+/*!
+ \brief 在线程池中解析配置文件，完成后发出loaded信号
+ \a appid 内部应用ID
+ \a name 配置文件名
+ \a subpath 配置文件子目录
+ \a localPrefix 配置文件的根目录
+ \return 是否开始新的解析，该资源正在解析时返回false，与其共用解析结果
+ */
+bool ConfigFileLoader::load(const QString &appid, const QString &name, const QString &subpath, const QString &localPrefix)
+{
+    const auto &key = getResourceKey(appid, getGenericResourceKey(name, subpath));
+    if (m_loadingKeys.contains(key))
+        return false;
+
+    m_loadingKeys.insert(key);
+    // it's initialized lazily, and isn't safe to be initialized on the worker.
+    const auto &cachePathPrefix = configPrefixPath() + "/global";
+    auto writer = m_writer.data();
+    auto job = [this, key, appid, name, subpath, localPrefix, cachePathPrefix, writer]() {
+        // the snapshot of the retired file may be still writing.
+        if (writer)
+            writer->wait(key);
+
+        std::unique_ptr<DConfigFile> file(new DConfigFile(innerAppidToOuter(appid), name, subpath));
+        file->globalCache()->setCachePathPrefix(cachePathPrefix);
+        if (!file->load(localPrefix))
+            file.reset();
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_results.insert(key, file.release());
+        }
+        QMetaObject::invokeMethod(this, "deliverResults", Qt::QueuedConnection);
+    };
+    m_pool.start(new ConfigFileLoadJob(job));
+    qCDebug(cfLog) << "Start loading the configuration file:" << key;
+    return true;
+}
+
+bool ConfigFileLoader::isLoading(const ResourceKey &key) const
+{
+    return m_loadingKeys.contains(key);
+}
+
+int ConfigFileLoader::pendingCount() const
+{
+    return m_loadingKeys.size();
+}
+
+/*!
+ \brief 配置文件变化时丢弃该资源所有应用正在解析的结果
+ \a key 通用资源键
+ */
+void ConfigFileLoader::invalidate(const GenericResourceKey &key)
+{
+    invalidate([&key](const ResourceKey &item) {
+        return getGenericResourceKeyByResourceKey(item) == key;
+    });
+}
+
+/*!
+ \brief 丢弃满足条件的正在解析的结果
+ */
+void ConfigFileLoader::invalidate(const std::function<bool(const ResourceKey &)> &predicate)
+{
+    for (const auto &item : std::as_const(m_loadingKeys)) {
+        if (predicate(item))
+            m_staleKeys.insert(item);
+    }
+}
+
+/*!
+ \brief 等待所有解析完成并丢弃结果，不再发出loaded信号
+ */
+void ConfigFileLoader::waitForDone()
+{
+    m_pool.waitForDone();
+    QMutexLocker locker(&m_mutex);
+    qDeleteAll(m_results);
+    m_results.clear();
+    m_loadingKeys.clear();
+    m_staleKeys.clear();
+}
+
+void ConfigFileLoader::deliverResults()
+{
+    QHash<ResourceKey, DConfigFile *> results;
+    {
+        QMutexLocker locker(&m_mutex);
+        results.swap(m_results);
+    }
+    for (auto iter = results.begin(); iter != results.end(); ++iter) {
+        auto file = iter.value();
+        m_loadingKeys.remove(iter.key());
+        if (m_staleKeys.remove(iter.key())) {
+            qCDebug(cfLog) << "Discard the configuration file changed while loading:" << iter.key();
+            delete file;
+            file = nullptr;
+        }
+        Q_EMIT loaded(iter.key(), file);
+    }
+}
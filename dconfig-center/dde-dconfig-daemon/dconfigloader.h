@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <dtkcore_global.h>
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QPointer>
+#include <functional>
+
+DCORE_BEGIN_NAMESPACE
+class DConfigFile;
+DCORE_END_NAMESPACE
+
+class ConfigPersistenceWriter;
+
+/**
+ * @brief The ConfigFileLoader class
+ * 在线程池中解析配置文件（描述文件、覆盖文件及全局缓存），解析完成后在主线程通知，
+ * 同一资源同时只解析一次，解析期间该资源的配置文件变化时丢弃解析结果。
+ */
+class ConfigFileLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigFileLoader(QObject *parent = nullptr);
+    virtual ~ConfigFileLoader() override;
+
+    void setPersistenceWriter(ConfigPersistenceWriter *writer);
+    int maxThreadCount() const;
+    void setMaxThreadCount(const int count);
+
+    bool load(const QString &appid, const QString &name, const QString &subpath, const QString &localPrefix);
+    bool isLoading(const ResourceKey &key) const;
+    int pendingCount() const;
+    void invalidate(const GenericResourceKey &key);
+    void invalidate(const std::function<bool(const ResourceKey &)> &predicate);
+    void waitForDone();
+
+Q_SIGNALS:
+    // the receiver takes the file, it's null if the file can't be loaded or it's changed while loading.
+    void loaded(const ResourceKey &key, DTK_CORE_NAMESPACE::DConfigFile *file);
+
+private Q_SLOTS:
+    void deliverResults();
+
+private:
+    QThreadPool m_pool;
+    QPointer<ConfigPersistenceWriter> m_writer;
+    // keys being loaded, and the ones changed while loading, only used on the main thread.
+    QSet<ResourceKey> m_loadingKeys;
+    QSet<ResourceKey> m_staleKeys;
+    // results of the finished jobs, taken on the main thread.
+    QMutex m_mutex;
+    QHash<ResourceKey, DTK_CORE_NAMESPACE::DConfigFile *> m_results;
+};
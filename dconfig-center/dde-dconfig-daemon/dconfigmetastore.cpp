@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigmetastore.h"
+
+#include <DConfigFile>
+#include <QDebug>
+
+DCORE_USE_NAMESPACE
+
+// it covers resources acquired by a login session.
+static constexpr int DefaultCapacity = 128;
+
+ConfigMetaStore::ConfigMetaStore(QObject *parent)
+    : QObject(parent)
+    , m_capacity(DefaultCapacity)
+{
+}
+
+ConfigMetaStore::~ConfigMetaStore()
+{
+    clear();
+}
+
+int ConfigMetaStore::capacity() const
+{
+    return m_capacity;
+}
+
+/*!
+ \brief 设置保留的配置文件数量，为0时不保留
+ \a capacity 配置文件数量
+ */
+void ConfigMetaStore::setCapacity(const int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    while (m_recentKeys.size() > m_capacity) {
+        const auto key = m_recentKeys.takeFirst();
+        delete m_files.take(key);
+    }
+}
+
+int ConfigMetaStore::size() const
+{
+    return m_files.size();
+}
+
+bool ConfigMetaStore::contains(const ResourceKey &key) const
+{
+    return m_files.contains(key);
+}
+
+/*!
+ \brief 取出保留的配置文件，调用者负责释放
+ \a key 资源键
+ \return 配置文件，不存在时返回空
+ */
+DConfigFile *ConfigMetaStore::take(const ResourceKey &key)
+{
+    auto file = m_files.take(key);
+    if (file)
+        m_recentKeys.removeOne(key);
+    return file;
+}
+
+/*!
+ \brief 保留已释放资源的配置文件，文件的保存任务需要已提交
+ \a key 资源键
+ \a file 配置文件，由此对象负责释放
+ */
+void ConfigMetaStore::put(const ResourceKey &key, DConfigFile *file)
+{
+    if (auto old = m_files.take(key)) {
+        m_recentKeys.removeOne(key);
+        if (old != file)
+            delete old;
+    }
+    if (m_capacity <= 0) {
+        delete file;
+        return;
+    }
+
+    m_files.insert(key, file);
+    m_recentKeys.append(key);
+    if (m_recentKeys.size() > m_capacity) {
+        const auto oldestKey = m_recentKeys.takeFirst();
+        delete m_files.take(oldestKey);
+    }
+}
+
+/*!
+ \brief 配置文件变化时移除该资源所有应用的配置文件
+ \a key 通用资源键
+ */
+void ConfigMetaStore::invalidate(const GenericResourceKey &key)
+{
+    invalidate([&key](const ResourceKey &item) {
+        return getGenericResourceKeyByResourceKey(item) == key;
+    });
+}
+
+/*!
+ \brief 移除满足条件的配置文件，如依赖变化的描述文件或覆盖文件的配置文件
+ */
+void ConfigMetaStore::invalidate(const std::function<bool(const ResourceKey &)> &predicate)
+{
+    for (auto iter = m_files.begin(); iter != m_files.end();) {
+        if (predicate(iter.key())) {
+            qCDebug(cfLog) << "Invalidate the stored configuration file:" << iter.key();
+            m_recentKeys.removeOne(iter.key());
+            delete iter.value();
+            iter = m_files.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+void ConfigMetaStore::clear()
+{
+    for (auto iter = m_files.begin(); iter != m_files.end(); ++iter)
+        delete iter.value();
+    m_files.clear();
+    m_recentKeys.clear();
+}
@@ -0,0 +1,48 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "dconfig_global.h"
+#include <dtkcore_global.h>
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <functional>
+
+DCORE_BEGIN_NAMESPACE
+class DConfigFile;
+DCORE_END_NAMESPACE
+
+/**
+ * @brief The ConfigMetaStore class
+ * 保留已释放资源解析后的配置文件（描述文件及覆盖文件的解析结果和全局缓存），
+ * 再次获取资源时直接复用，配置文件变化时失效，超过容量时淘汰最久未使用的文件。
+ * 只在同一服务进程中复用，服务启动后首次获取仍需解析描述文件，由启动后的预加载填充。
+ * 淘汰或失效的文件直接在主线程释放，写线程只使用保存时生成的快照，不访问文件对象。
+ */
+class ConfigMetaStore : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigMetaStore(QObject *parent = nullptr);
+    virtual ~ConfigMetaStore() override;
+
+    int capacity() const;
+    void setCapacity(const int capacity);
+    int size() const;
+    bool contains(const ResourceKey &key) const;
+
+    DTK_CORE_NAMESPACE::DConfigFile *take(const ResourceKey &key);
+    void put(const ResourceKey &key, DTK_CORE_NAMESPACE::DConfigFile *file);
+    void invalidate(const GenericResourceKey &key);
+    void invalidate(const std::function<bool(const ResourceKey &)> &predicate);
+    void clear();
+
+private:
+    QHash<ResourceKey, DTK_CORE_NAMESPACE::DConfigFile *> m_files;
+    // the most recently released is the last.
+    QList<ResourceKey> m_recentKeys;
+    int m_capacity;
+};
@@ -295,6 +295,21 @@ int RefManager::getRefResourceCountOnTheSR(const ConnServiceName &service, const
     return resources.value(resource)->count(serviceRef);
 }
 
+/*!
+ \brief 获得所有服务对连接的有效引用，用于服务重启时恢复
+ */
+QList<ConnReference> RefManager::references() const
+{
+    QList<ConnReference> result;
+    for (auto resourceRef : resources) {
+        for (auto iter = resourceRef->services.cbegin(); iter != resourceRef->services.cend(); ++iter) {
+            if (iter.value() > 0)
+                result << ConnReference{iter.key()->service, resourceRef->resource, iter.value()};
+        }
+    }
+    return result;
+}
+
 /*!
   \internal
  \brief 获得服务数量
@@ -417,9 +432,11 @@ void RefManager::delayDeleteResource(const QList<ResourceRef *> &deleteResources
 ConfigSyncRequestCache::ConfigSyncRequestCache(QObject *parent)
     : QObject (parent)
     , m_syncTimer(new QBasicTimer())
-    , m_delaySyncTime(3000)
+    , m_delaySyncTime(500)
+    , m_maxSyncStaleness(10000)
     , m_batchCount(20)
 {
+    m_clock.start();
 }
 
 ConfigSyncRequestCache::~ConfigSyncRequestCache()
@@ -430,13 +447,20 @@ ConfigSyncRequestCache::~ConfigSyncRequestCache()
     m_syncTimer = nullptr;
 }
 
+/*!
+ \brief 添加同步请求
+ 请求在没有新请求的`delaySyncTime`后同步，持续有请求时合并同步，
+ 但每个请求等待的时间不超过`maxSyncStaleness`。
+ \a key 同步请求的键
+ */
 void ConfigSyncRequestCache::pushRequest(const ConfigCacheKey &key)
 {
-    if (m_configCacheKeys.contains(key))
-        return;
-
-    qCDebug(cfLog()) << "Push syncConfigRequest key:" << key;
-    m_configCacheKeys.insert(key);
+    m_lastPushTime = m_clock.elapsed();
+    if (!m_configCacheKeys.contains(key)) {
+        qCDebug(cfLog()) << "Push syncConfigRequest key:" << key;
+        m_configCacheKeys.insert(key, m_lastPushTime + m_maxSyncStaleness);
+        m_requestQueue.enqueue(key);
+    }
     if (!m_syncTimer->isActive()) {
         m_syncTimer->start(m_delaySyncTime, this);
     }
@@ -445,6 +469,7 @@ void ConfigSyncRequestCache::pushRequest(const ConfigCacheKey &key)
 void ConfigSyncRequestCache::clear()
 {
     m_configCacheKeys.clear();
+    m_requestQueue.clear();
 
     if (m_syncTimer->isActive())
         m_syncTimer->stop();
@@ -454,12 +479,12 @@ static const QString ConfigSyncRequestCacheGlobalPrefix("g-");
 static const QString ConfigSyncRequestCacheUserPrefix("u-");
 ConfigCacheKey ConfigSyncRequestCache::globalKey(const ResourceKey &key)
 {
-    return QString("%1%2").arg(ConfigSyncRequestCacheGlobalPrefix).arg(key);
+    return ConfigSyncRequestCacheGlobalPrefix + key;
 }
 
 ConfigCacheKey ConfigSyncRequestCache::userKey(const ConnKey &key)
 {
-    return QString("%1%2").arg(ConfigSyncRequestCacheUserPrefix).arg(key);
+    return ConfigSyncRequestCacheUserPrefix + key;
 }
 
 bool ConfigSyncRequestCache::isGlobalKey(const ConfigCacheKey &key)
@@ -497,6 +522,16 @@ void ConfigSyncRequestCache::setDelaySyncTime(const int time)
     m_delaySyncTime = time;
 }
 
+int ConfigSyncRequestCache::maxSyncStaleness() const
+{
+    return m_maxSyncStaleness;
+}
+
+void ConfigSyncRequestCache::setMaxSyncStaleness(const int time)
+{
+    m_maxSyncStaleness = time;
+}
+
 int ConfigSyncRequestCache::batchCount() const
 {
     return m_batchCount;
@@ -510,23 +545,67 @@ void ConfigSyncRequestCache::setBatchCount(const int count)
 void ConfigSyncRequestCache::timerEvent(QTimerEvent *event)
 {
     if (event->timerId() == m_syncTimer->timerId()) {
-        customRequest();
-
-        if (m_configCacheKeys.isEmpty())
-            m_syncTimer->stop();
+        scheduleRequest();
     }
 
     return QObject::timerEvent(event);
 }
 
+/*!
+ \internal
+ \brief 请求持续到来时推迟同步，直到最早的请求到期，剩余的请求在下一个`delaySyncTime`后继续同步
+ */
+void ConfigSyncRequestCache::scheduleRequest()
+{
+    if (m_configCacheKeys.isEmpty()) {
+        m_syncTimer->stop();
+        return;
+    }
+
+    const qint64 now = m_clock.elapsed();
+    const qint64 quietTime = m_lastPushTime + m_delaySyncTime;
+    const qint64 deadline = m_configCacheKeys.value(m_requestQueue.head());
+    if (now < quietTime && now < deadline) {
+        m_syncTimer->start(static_cast<int>(qMin(quietTime, deadline) - now), this);
+        return;
+    }
+
+    customRequest();
+
+    if (m_configCacheKeys.isEmpty()) {
+        m_syncTimer->stop();
+    } else {
+        m_syncTimer->start(m_delaySyncTime, this);
+    }
+}
+
+/*
+  \internal
+
+    \breaf count of requests synced in the next batch, it grows with the queued requests
+    so that they're all synced in `maxSyncStaleness`, and it's not less than `batchCount`.
+*/
+int ConfigSyncRequestCache::adaptiveBatchCount() const
+{
+    const int batches = qMax(m_maxSyncStaleness / qMax(m_delaySyncTime, 1), 1);
+    return qMax(qMax(m_batchCount, 1), (requestsCount() + batches - 1) / batches);
+}
+
 void ConfigSyncRequestCache::customRequest()
 {
     if (!m_configCacheKeys.isEmpty()) {
+        // expired requests are synced in the batch, even if they're more than the batch count.
+        const qint64 now = m_clock.elapsed();
+        const int batchCount = adaptiveBatchCount();
         ConfigSyncBatchRequest request;
-        int i = 0;
-        for (auto iter = m_configCacheKeys.begin(); iter != m_configCacheKeys.end() && i < m_batchCount; i++) {
-            request.data << *iter;
-            iter = m_configCacheKeys.erase(iter);
+        while (!m_requestQueue.isEmpty()) {
+            const auto &key = m_requestQueue.head();
+            if (request.data.count() >= batchCount && m_configCacheKeys.value(key) > now)
+                break;
+
+            request.data << key;
+            m_configCacheKeys.remove(key);
+            m_requestQueue.dequeue();
         }
         qCDebug(cfLog, "Start sync config cache, syncConfigRequest count:%d, elapsed count:%d",
                 request.data.count(), m_configCacheKeys.count());
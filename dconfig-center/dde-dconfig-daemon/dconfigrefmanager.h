@@ -9,10 +9,22 @@
 #include <QHash>
 #include <QMap>
 #include <QTimer>
+#include <QQueue>
+#include <QElapsedTimer>
 
 class ResourceRef;
 class ServiceRef;
 
+/**
+ * @brief The ConnReference struct
+ * 服务对连接的引用数量
+ */
+struct ConnReference {
+    ConnServiceName service;
+    ConnKey key;
+    int count = 0;
+};
+
 class RefManager : public QObject{
     Q_OBJECT
 public:
@@ -41,6 +53,8 @@ public:
     int getRefResourceCountOnTheService(const ConnServiceName &service);
     int getRefResourceCountOnTheSR(const ConnServiceName &service, const ConnKey &resource);
 
+    QList<ConnReference> references() const;
+
 Q_SIGNALS:
     // 资源无服务使用时，释放资源
     void releaseResource(const ConnKey &resource);
@@ -94,6 +108,8 @@ public:
     int requestsCount() const;
     int delaySyncTime() const;
     void setDelaySyncTime(const int time);
+    int maxSyncStaleness() const;
+    void setMaxSyncStaleness(const int time);
     int batchCount() const;
     void setBatchCount(const int count);
 
@@ -105,10 +121,20 @@ protected:
 
 private:
     void customRequest();
+    void scheduleRequest();
+    int adaptiveBatchCount() const;
 
     QBasicTimer *m_syncTimer = nullptr;
-    QSet<ConfigCacheKey> m_configCacheKeys;
+    // key -> deadline of the request, keys in `m_requestQueue` are in the order of pushing.
+    QHash<ConfigCacheKey, qint64> m_configCacheKeys;
+    QQueue<ConfigCacheKey> m_requestQueue;
+    QElapsedTimer m_clock;
+    qint64 m_lastPushTime = 0;
+    // quiet time after the last request before syncing.
     int m_delaySyncTime;
+    // maximum time a request waits for syncing.
+    int m_maxSyncStaleness;
+    // minimum count of requests synced in one batch, it's larger when many requests are queued.
     int m_batchCount;
 };
 
@@ -5,11 +5,17 @@
 #include "dconfigresource.h"
 #include "dconfigconn.h"
 #include "dconfigrefmanager.h"
+#include "dconfigwriter.h"
+#include "dconfigjournal.h"
+#include "dconfigmetastore.h"
+#include "dconfigdependency.h"
+#include "dconfigstats.h"
 #include "dconfigfile.h"
 #include <QDBusMessage>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
 #include <QFile>
+#include <QScopedValueRollback>
 #include <QDebug>
 
 #include "manager_adaptor.h"
@@ -17,6 +23,29 @@
 Q_DECLARE_LOGGING_CATEGORY(cfLog);
 DCORE_USE_NAMESPACE
 
+/*
+  \internal
+
+    \breaf save the object if it's dirty, it's serialized on the caller's thread and
+    only the bytes are written by the persistence writer, so the object can be
+    modified or deleted once it returns. its journal records aren't needed after it.
+*/
+template<class T>
+void DSGConfigResource::saveObject(const QString &id, T *object, bool dirty)
+{
+    if (!dirty)
+        return;
+
+    if (!m_writer) {
+        object->save(m_localPrefix);
+    } else {
+        m_writer->write(id, m_writer->capture(id, [object](const QString &prefix) {
+            return object->save(prefix);
+        }, m_localPrefix));
+    }
+    if (m_journal)
+        m_journal->markSaved(id);
+}
 
 DSGConfigResource::DSGConfigResource(const QString &name, const QString &subpath, const QString &localPrefix, QObject *parent)
     : QObject (parent),
@@ -31,14 +60,26 @@ DSGConfigResource::~DSGConfigResource()
 {
     qDeleteAll(m_conns);
     m_conns.clear();
+    m_resourceConns.clear();
+    m_uidConns.clear();
 
-    save();
-
-    qDeleteAll(m_files);
+    qDebug(cfLog, "Save resource's cache for [%s], and cache count:%d", qPrintable(m_key), m_caches.count());
+    for (auto iter = m_files.begin(); iter != m_files.end(); ++iter) {
+        if (m_dependencies)
+            m_dependencies->removeFile(iter.key());
+        retireFile(iter.key(), iter.value());
+    }
     m_files.clear();
+    m_dirtyFiles.clear();
+    m_metaIndexes.clear();
 
-    qDeleteAll(m_caches);
+    for (auto iter = m_caches.begin(); iter != m_caches.end(); ++iter) {
+        saveObject(iter.key(), iter.value(), m_dirtyCaches.contains(iter.key()));
+        delete iter.value();
+    }
     m_caches.clear();
+    m_dirtyCaches.clear();
+    m_resourceCaches.clear();
 }
 
 bool DSGConfigResource::load(const QString &appid)
@@ -51,6 +92,109 @@ void DSGConfigResource::setSyncRequestCache(ConfigSyncRequestCache *cache)
     m_syncRequestCache = cache;
 }
 
+void DSGConfigResource::setCredentialsCache(PeerCredentialsCache *cache)
+{
+    m_credentialsCache = cache;
+}
+
+PeerCredentialsCache *DSGConfigResource::credentialsCache() const
+{
+    return m_credentialsCache;
+}
+
+void DSGConfigResource::setPersistenceWriter(ConfigPersistenceWriter *writer)
+{
+    m_writer = writer;
+}
+
+void DSGConfigResource::setJournal(ConfigJournal *journal)
+{
+    m_journal = journal;
+}
+
+void DSGConfigResource::setMetaStore(ConfigMetaStore *store)
+{
+    m_metaStore = store;
+}
+
+void DSGConfigResource::setDependencyGraph(ConfigDependencyGraph *graph)
+{
+    m_dependencies = graph;
+}
+
+void DSGConfigResource::setStatistics(ConfigStatistics *statistics)
+{
+    m_statistics = statistics;
+}
+
+ConfigStatistics *DSGConfigResource::statistics() const
+{
+    return m_statistics;
+}
+
+/*!
+ \brief 记录已接受的配置项修改，保存前服务异常退出时可以恢复
+ \a connKey 连接的键
+ \a key 配置项名称
+ \a value 设置的值，无效值表示重置
+ \a callerAppid 调用者
+ */
+void DSGConfigResource::appendJournal(const ConnKey &connKey, const QString &key, const QVariant &value, const QString &callerAppid)
+{
+    if (!m_journal)
+        return;
+
+    ConfigJournalRecord record;
+    record.appid = getAppidByResourceKey(getResourceKey(connKey));
+    record.name = m_fileName;
+    record.subpath = m_subpath;
+    record.uid = getConnectionKey(connKey);
+    record.key = key;
+    record.value = value;
+    record.callerAppid = callerAppid;
+    // the record is needed until the object marked dirty by it is saved.
+    const auto &resourceKey = getResourceKey(connKey);
+    const bool global = keyFlags(resourceKey, key).testFlag(DConfigFile::Global);
+    m_journal->append(record, global ? resourceKey : connKey);
+}
+
+/*!
+ \brief 已记录的修改同步到磁盘后再回复调用者
+ \a connection 调用者所在的连接
+ \a message 调用消息
+ \return 是否延迟回复，未启用日志时返回false
+ */
+bool DSGConfigResource::replyAfterJournalSynced(const QDBusConnection &connection, const QDBusMessage &message)
+{
+    return m_journal && m_journal->replyAfterSync(connection, message);
+}
+
+/*!
+ \brief 恢复日志中记录的配置项修改
+ \return 配置项的值是否被修改
+ */
+bool DSGConfigResource::restoreValue(const QString &appid, const uint uid, const QString &key, const QVariant &value, const QString &callerAppid)
+{
+    auto file = getOrCreateFile(appid);
+    if (!file)
+        return false;
+
+    auto cache = getOrCreateCache(appid, uid);
+    if (!cache)
+        return false;
+
+    if (!file->setValue(key, value, callerAppid, cache))
+        return false;
+
+    const auto &resourceKey = getResourceKey(appid, m_key);
+    if (keyFlags(resourceKey, key).testFlag(DConfigFile::Global)) {
+        m_dirtyFiles.insert(resourceKey);
+    } else {
+        m_dirtyCaches.insert(getConnectionKey(resourceKey, uid));
+    }
+    return true;
+}
+
 DSGConfigConn *DSGConfigResource::getConn(const QString &appid, const uint uid) const
 {
     const ConnKey &connKey = getConnKey(appid, uid);
@@ -92,15 +236,16 @@ DSGConfigConn *DSGConfigResource::createConn(const QString &appid, const uint ui
 
     // Add cache to `m_caches` only initialized successful, otherwise it should be deleted.
     if (cacheHolder)
-        m_caches.insert(connKey, cacheHolder.release());
+        insertCache(connKey, cacheHolder.release());
 
     auto conn = connPointer.release();
-    m_conns.insert(connKey, conn);
+    insertConn(connKey, conn);
     conn->setResource(this);
 
     QObject::connect(conn, &DSGConfigConn::releaseChanged, this, &DSGConfigResource::onReleaseChanged);
     QObject::connect(conn, &DSGConfigConn::globalValueChanged, this, &DSGConfigResource::onGlobalValueChanged);
     QObject::connect(conn, &DSGConfigConn::valueChanged, this, &DSGConfigResource::onValueChanged);
+    QObject::connect(conn, &DSGConfigConn::batchValueChanged, this, &DSGConfigResource::onBatchValueChanged);
     return conn;
 }
 
@@ -120,6 +265,7 @@ int DSGConfigResource::connSize() const
  */
 bool DSGConfigResource::reparse(const QString &appid)
 {
+    ConfigLatencyTimer timer(m_statistics, ConfigStatistics::Reparse);
     const auto &resouceKey = getResourceKey(appid, m_key);
     auto file = getFile(resouceKey);
     if (!file)
@@ -135,17 +281,25 @@ bool DSGConfigResource::reparse(const QString &appid)
 
     QMap<DConfigCache*, QList<QString>> cacheChangedValues;
     DConfigMeta *oldMeta = file->meta();
-    QList<DConfigCache*> caches;
+    const auto &diff = metaDiff(oldMeta, newMeta);
+    qCDebug(cfLog()) << "Reparse resource:" << resouceKey << "added:" << diff.added << "removed:" << diff.removed
+                     << "changed:" << diff.changed;
+    // only values of the removed and changed keys may be different.
+    QList<QString> diffKeys = diff.removed;
+    diffKeys << diff.changed;
 
-    for (auto  item : cachesOfTheResource(resouceKey))
-        caches.push_back(item);
+    QList<DConfigCache*> caches;
+    if (!diffKeys.isEmpty()) {
+        for (auto  item : cachesOfTheResource(resouceKey))
+            caches.push_back(item);
 
-    caches.push_back(file->globalCache());
+        caches.push_back(file->globalCache());
+    }
 
     // cache and valuechanged.
     for (auto cache : caches) {
         QList<QString> changedValues;
-        for (auto key : oldMeta->keyList()) {
+        for (const auto &key : std::as_const(diffKeys)) {
             if (oldMeta->flags(key).testFlag(DConfigFile::Global) ^ cache->isGlobal())
                 continue;
 
@@ -157,12 +311,25 @@ bool DSGConfigResource::reparse(const QString &appid)
         if (!changedValues.isEmpty()) {
             cacheChangedValues[cache] = changedValues;
         }
-        repareCache(cache, oldMeta, newMeta);
+        if (repareCache(cache, diff)) {
+            if (cache->isGlobal()) {
+                requestSyncFile(resouceKey);
+            } else {
+                requestSyncCache(getConnectionKey(resouceKey, cache->uid()));
+            }
+        }
     }
 
     // config refresh.
     std::unique_ptr<DConfigFile> oldConfig(file);
-    m_files[resouceKey] = config.release();
+    insertFile(resouceKey, config.release());
+
+    // generic configuration is the fallback of all application's connections.
+    if (!diff.isEmpty()) {
+        const auto &affectedConns = appid == VirtualInterAppId ? m_conns.values() : connsOfTheResource(resouceKey);
+        for (auto conn : affectedConns)
+            conn->clearValueCache();
+    }
 
     // emit valuechanged.
     for (auto iter = cacheChangedValues.begin(); iter != cacheChangedValues.end(); ++iter) {
@@ -175,6 +342,11 @@ bool DSGConfigResource::reparse(const QString &appid)
                 for (const QString &key : iter.value()) {
                     emit conn->valueChanged(key);
                 }
+            } else if (appid == VirtualInterAppId) {
+                // the generic cache is loaded for the fallback of application's connections.
+                const auto &connKey = getConnectionKey(resouceKey, iter.key()->uid());
+                for (const QString &key : iter.value())
+                    doUpdateGenericConfigValueChanged(key, connKey);
             } else {
                 qWarning() << "Invalid connection:" << getConnKey(appid, iter.key()->uid());
             }
@@ -199,13 +371,13 @@ void DSGConfigResource::doSyncConfigCache(const ConfigCacheKey &key)
         const auto connKey = ConfigSyncRequestCache::getUserKey(key);
         if (auto cache = getCache(connKey)) {
             qCDebug(cfLog()) << "Sync conn cache for user cache, key:" << key;
-            cache->save(m_localPrefix);
+            saveObject(connKey, cache, m_dirtyCaches.remove(connKey));
         }
     } else if (ConfigSyncRequestCache::isGlobalKey(key)) {
         const auto resourceKey = ConfigSyncRequestCache::getGlobalKey(key);
         if (auto file = getFile(resourceKey)) {
             qCDebug(cfLog()) << "Sync conn cache for global cache, key:" << key;
-            file->save(m_localPrefix);
+            saveObject(resourceKey, file, m_dirtyFiles.remove(resourceKey));
         }
     } else {
         qCWarning(cfLog()) << "It's not exist config cache key" << key;
@@ -214,10 +386,24 @@ void DSGConfigResource::doSyncConfigCache(const ConfigCacheKey &key)
 
 bool DSGConfigResource::fallbackToGenericConfig() const
 {
+    if (m_fallbackResolved)
+        return m_canFallbackToGeneric;
+
     // 判断是否需要fallback到公共配置
     DConfigFile file(NoAppId, m_fileName, m_subpath);
-    const bool canFallbackToGeneric = !file.meta()->metaPath(m_localPrefix).isEmpty();
-    return canFallbackToGeneric;
+    m_canFallbackToGeneric = !file.meta()->metaPath(m_localPrefix).isEmpty();
+    m_fallbackResolved = true;
+    return m_canFallbackToGeneric;
+}
+
+/*!
+ \brief 通用配置的描述文件可能新增或移除，重新判断是否需要fallback到公共配置
+ */
+void DSGConfigResource::invalidateFallbackToGenericConfig()
+{
+    m_fallbackResolved = false;
+    for (auto conn : specificAppConns())
+        conn->clearValueCache();
 }
 
 DConfigCache *DSGConfigResource::noAppidCache(const uint uid) const
@@ -236,15 +422,70 @@ DConfigFile *DSGConfigResource::getOrCreateFile(const QString &appid)
     if (auto file = m_files.value(resourceKey))
         return file;
 
+    // the snapshot of the retired file may be still writing.
+    if (m_writer)
+        m_writer->wait(resourceKey);
+
+    if (m_metaStore) {
+        if (auto file = m_metaStore->take(resourceKey)) {
+            qCDebug(cfLog) << "Reuse the stored configuration file:" << resourceKey;
+            insertFile(resourceKey, file);
+            return file;
+        }
+    }
+
     std::unique_ptr<DConfigFile> file(new DConfigFile(innerAppidToOuter(appid), m_fileName, m_subpath));
     file->globalCache()->setCachePathPrefix(configPrefixPath() + "/global");
     if (!file->load(m_localPrefix))
         return nullptr;
 
-    m_files.insert(resourceKey, file.get());
+    insertFile(resourceKey, file.get());
     return file.release();
 }
 
+/*
+  \internal
+
+    \breaf Add or replace the file, and rebuild the key index of its meta.
+*/
+void DSGConfigResource::insertFile(const ResourceKey &key, DConfigFile *file)
+{
+    auto meta = file->meta();
+    const auto &keys = meta->keyList();
+    ConfigMetaIndex index;
+    index.reserve(keys.size());
+    for (const auto &item : keys)
+        index.insert(item, ConfigMetaItem{meta->flags(item), meta->permissions(item), meta->visibility(item)});
+
+    m_files.insert(key, file);
+    m_metaIndexes.insert(key, index);
+    if (m_dependencies)
+        m_dependencies->addFile(key, meta->metaPath(m_localPrefix));
+}
+
+void DSGConfigResource::removeFile(const ResourceKey &key)
+{
+    m_files.remove(key);
+    m_metaIndexes.remove(key);
+    if (m_dependencies)
+        m_dependencies->removeFile(key);
+}
+
+/*
+  \internal
+
+    \breaf Save the removed file if it's dirty, and keep it in the store to avoid parsing again.
+*/
+void DSGConfigResource::retireFile(const ResourceKey &key, DConfigFile *file)
+{
+    saveObject(key, file, m_dirtyFiles.remove(key));
+    if (!m_metaStore) {
+        delete file;
+        return;
+    }
+    m_metaStore->put(key, file);
+}
+
 DConfigCache *DSGConfigResource::getOrCreateCache(const QString &appid, const uint uid)
 {
     const auto connKey = getConnectionKey(getResourceKey(appid, m_key), uid);
@@ -252,7 +493,7 @@ DConfigCache *DSGConfigResource::getOrCreateCache(const QString &appid, const ui
         return cache;
 
     if (auto cache = createCache(appid, uid)) {
-        m_caches.insert(connKey, cache);
+        insertCache(connKey, cache);
         return cache;
     }
     return nullptr;
@@ -262,6 +503,10 @@ DConfigCache *DSGConfigResource::createCache(const QString &appid, const uint ui
 {
     const auto resourceKey = getResourceKey(appid, m_key);
     if (auto file = getFile(resourceKey)) {
+        // the snapshot of the retired cache may be still writing.
+        if (m_writer)
+            m_writer->wait(getConnectionKey(resourceKey, uid));
+
         std::unique_ptr<DConfigCache> cache(file->createUserCache(uid));
         cache->setCachePathPrefix(configPrefixPath() + QString("/%1").arg(uid));
         if (cache->load(m_localPrefix))
@@ -280,63 +525,115 @@ DConfigCache *DSGConfigResource::getCache(const ConnKey &key) const
     return m_caches.value(key);
 }
 
+const ConfigMetaIndex *DSGConfigResource::metaIndex(const ResourceKey &key) const
+{
+    auto iter = m_metaIndexes.constFind(key);
+    return iter != m_metaIndexes.constEnd() ? &iter.value() : nullptr;
+}
+
+DConfigFile::Flags DSGConfigResource::keyFlags(const ResourceKey &resourceKey, const QString &key) const
+{
+    if (auto index = metaIndex(resourceKey)) {
+        auto iter = index->constFind(key);
+        if (iter != index->constEnd())
+            return iter->flags;
+    }
+    return DConfigFile::Flags();
+}
+
 /*
     @breaf Get all Connectons expect application independent Connection.
 */
 QList<DSGConfigConn *> DSGConfigResource::specificAppConns() const
 {
+    const auto &genericResourceKey = getResourceKey(VirtualInterAppId, m_key);
     QList<DSGConfigConn *> result;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        if (isGenericResourceConn(iter.key()))
+    for (auto iter = m_resourceConns.begin(); iter != m_resourceConns.end(); ++iter) {
+        if (iter.key() == genericResourceKey)
             continue;
-        result << iter.value();
+        result << iter.value().values();
     }
     return result;
 }
 
 bool DSGConfigResource::cacheExist(const ResourceKey &key) const
 {
-    for (const auto &item : m_caches.keys()) {
-        if (getResourceKey(item) == key)
-            return true;
-    }
-    return false;
+    return m_resourceCaches.contains(key);
 }
 
 QList<DConfigCache *> DSGConfigResource::cachesOfTheResource(const ResourceKey &resourceKey) const
 {
-    QList<DConfigCache *> result;
-    for (auto iter = m_caches.begin(); iter != m_caches.end(); ++iter) {
-        if (getResourceKey(iter.key()) != resourceKey)
-            continue;
-        result << iter.value();
-    }
-    return result;
+    return m_resourceCaches.value(resourceKey).values();
 }
 
 QList<DSGConfigConn *> DSGConfigResource::connsOfTheResource(const ResourceKey &resourceKey) const
 {
-    QList<DSGConfigConn *> result;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        if (getResourceKey(iter.key()) != resourceKey)
-            continue;
-        result << iter.value();
+    return m_resourceConns.value(resourceKey).values();
+}
+
+void DSGConfigResource::insertCache(const ConnKey &key, DConfigCache *cache)
+{
+    m_caches.insert(key, cache);
+    m_resourceCaches[getResourceKey(key)].insert(getConnectionKey(key), cache);
+}
+
+DConfigCache *DSGConfigResource::takeCache(const ConnKey &key)
+{
+    auto cache = m_caches.take(key);
+    if (!cache)
+        return nullptr;
+
+    auto iter = m_resourceCaches.find(getResourceKey(key));
+    if (iter != m_resourceCaches.end()) {
+        iter->remove(getConnectionKey(key));
+        if (iter->isEmpty())
+            m_resourceCaches.erase(iter);
     }
-    return result;
+    return cache;
+}
+
+void DSGConfigResource::insertConn(const ConnKey &key, DSGConfigConn *conn)
+{
+    m_conns.insert(key, conn);
+    m_resourceConns[conn->resourceKey()].insert(conn->uid(), conn);
+    m_uidConns[conn->uid()].insert(key);
+}
+
+DSGConfigConn *DSGConfigResource::takeConn(const ConnKey &key)
+{
+    auto conn = m_conns.take(key);
+    if (!conn)
+        return nullptr;
+
+    auto resourceIter = m_resourceConns.find(conn->resourceKey());
+    if (resourceIter != m_resourceConns.end()) {
+        resourceIter->remove(conn->uid());
+        if (resourceIter->isEmpty())
+            m_resourceConns.erase(resourceIter);
+    }
+    auto uidIter = m_uidConns.find(conn->uid());
+    if (uidIter != m_uidConns.end()) {
+        uidIter->remove(key);
+        if (uidIter->isEmpty())
+            m_uidConns.erase(uidIter);
+    }
+    return conn;
 }
 
 void DSGConfigResource::onValueChanged(const QString &key)
 {
     if (auto conn = qobject_cast<DSGConfigConn*>(sender())) {
         do {
-            const auto &resouceKey = getResourceKey(conn->key());
-            auto file = getFile(resouceKey);
+            const auto &resouceKey = conn->resourceKey();
             // global field changed don't cause user field to save, but `valueChanged` signal is emit.
-            if (file && Q_UNLIKELY(file->meta()->flags(key).testFlag(DConfigFile::Global)))
+            if (Q_UNLIKELY(keyFlags(resouceKey, key).testFlag(DConfigFile::Global)))
+                break;
+
+            // the batch has requested to sync once for all of its keys.
+            if (m_notifyingBatch)
                 break;
 
-            if (Q_LIKELY(m_syncRequestCache))
-                m_syncRequestCache->pushRequest(ConfigSyncRequestCache::userKey(conn->key()));
+            requestSyncCache(conn->key());
         } while (false);
 
         // to emit generic configuration's valueChanged if valueChanged is emited from generic configuration resource.
@@ -353,18 +650,18 @@ void DSGConfigResource::onValueChanged(const QString &key)
 void DSGConfigResource::doUpdateGenericConfigValueChanged(const QString &key, const ConnKey &connKey)
 {
 //    only generic configuration resource to emit generic configuration's valueChanged.
-    auto file = getFile(getResourceKey(connKey));
-    if (!file)
+    const auto &resourceKey = getResourceKey(connKey);
+    if (!getFile(resourceKey))
         return;
 
-    const bool isGlobal = file->meta()->flags(key).testFlag(DConfigFile::Global);
+    const bool isGlobal = keyFlags(resourceKey, key).testFlag(DConfigFile::Global);
     const auto uid = getConnectionKey(connKey);
     for (auto conn : specificAppConns()) {
         if (!conn->containsWithoutProp(key))
             continue;
 
-        if (isGlobal && uid == getConnectionKey(conn->key())) {
-            doGlobalValueChanged(key, getResourceKey(conn->key()));
+        if (isGlobal && uid == conn->uid()) {
+            doGlobalValueChanged(key, conn->resourceKey());
         } else {
             Q_EMIT conn->valueChanged(key);
         }
@@ -373,11 +670,16 @@ void DSGConfigResource::doUpdateGenericConfigValueChanged(const QString &key, co
 
 void DSGConfigResource::doGlobalValueChanged(const QString &key, const ResourceKey &resourceKey)
 {
-    if (Q_LIKELY(m_syncRequestCache))
-        m_syncRequestCache->pushRequest(ConfigSyncRequestCache::globalKey(resourceKey));
+    doGlobalValuesChanged({key}, resourceKey);
+}
+
+void DSGConfigResource::doGlobalValuesChanged(const QStringList &keys, const ResourceKey &resourceKey)
+{
+    requestSyncFile(resourceKey);
     // emit valueChanged of all conns for the resource.
     for (auto conn : connsOfTheResource(resourceKey)) {
-        emit conn->valueChanged(key);
+        for (const auto &key : keys)
+            emit conn->valueChanged(key);
     }
 }
 
@@ -386,31 +688,88 @@ void DSGConfigResource::doGlobalValueChanged(const QString &key, const ResourceK
 
     \breaf 重新解析缓存对象
 */
-void DSGConfigResource::repareCache(DConfigCache *cache, DConfigMeta *oldMeta, DConfigMeta *newMeta)
+bool DSGConfigResource::repareCache(DConfigCache *cache, const ConfigMetaDiff &diff)
 {
-    const auto newMetaKeys = newMeta->keyList();
-    const auto oldMetaKeys = oldMeta->keyList();
-    const QSet<QString> &newKeyList = {newMetaKeys.begin(), newMetaKeys.end()};
-    const QSet<QString> &oldKeyList = {oldMetaKeys.begin(), oldMetaKeys.end()};
-
+    bool removed = false;
     // 配置项已经被移除，oldMeta - newMeta，移除cache值
-    const auto subtractKeys = oldKeyList - (newKeyList);
-    for (const auto &key :subtractKeys) {
+    for (const auto &key : diff.removed) {
         cache->remove(key);
+        removed = true;
         qDebug(cfLog, "Cache removed because of meta item removed, resource:%s, uid:%d, key:%s.",
                qPrintable(m_key), cache->uid(), qPrintable(key));
     }
     // 权限变化，ReadWrite -> ReadOnly，移除cache值
-    auto intersectKeys = newKeyList;
-    intersectKeys = intersectKeys.intersect(oldKeyList);
-    for(const auto &key :intersectKeys) {
-        if (newMeta->permissions(key) == DConfigFile::ReadOnly &&
-                oldMeta->permissions(key) == DConfigFile::ReadWrite) {
-            cache->remove(key);
-            qDebug(cfLog, "Cache removed because of permissions changed from readwrite to readonly, resource:%s,uid:%d,key:%s.",
-                   qPrintable(m_key), cache->uid(), qPrintable(key));
+    for (const auto &key : diff.readOnly) {
+        cache->remove(key);
+        removed = true;
+        qDebug(cfLog, "Cache removed because of permissions changed from readwrite to readonly, resource:%s,uid:%d,key:%s.",
+               qPrintable(m_key), cache->uid(), qPrintable(key));
+    }
+    return removed;
+}
+
+/*!
+ \brief 比较重新解析前后的描述文件
+ \a oldMeta 原描述文件
+ \a newMeta 重新解析的描述文件
+ \return 新增、移除及默认值、标志、权限或序号变化的配置项
+ */
+ConfigMetaDiff DSGConfigResource::metaDiff(DConfigMeta *oldMeta, DConfigMeta *newMeta)
+{
+    ConfigMetaDiff diff;
+    const auto &oldKeys = oldMeta->keyList();
+    const auto &newKeys = newMeta->keyList();
+    const QSet<QString> newKeySet(newKeys.begin(), newKeys.end());
+    QSet<QString> oldKeySet;
+    oldKeySet.reserve(oldKeys.size());
+    for (const auto &key : oldKeys) {
+        oldKeySet.insert(key);
+        if (!newKeySet.contains(key)) {
+            diff.removed << key;
+            continue;
+        }
+
+        const auto oldPermissions = oldMeta->permissions(key);
+        const auto newPermissions = newMeta->permissions(key);
+        if (oldPermissions == DConfigFile::ReadWrite && newPermissions == DConfigFile::ReadOnly)
+            diff.readOnly << key;
+
+        if (oldPermissions != newPermissions
+                || oldMeta->flags(key) != newMeta->flags(key)
+                || oldMeta->serial(key) != newMeta->serial(key)
+                || oldMeta->value(key) != newMeta->value(key)) {
+            diff.changed << key;
         }
     }
+    for (const auto &key : newKeys) {
+        if (!oldKeySet.contains(key))
+            diff.added << key;
+    }
+    return diff;
+}
+
+/*
+  \internal
+
+    \breaf mark the user cache dirty and request to sync it.
+*/
+void DSGConfigResource::requestSyncCache(const ConnKey &connKey)
+{
+    m_dirtyCaches.insert(connKey);
+    if (Q_LIKELY(m_syncRequestCache))
+        m_syncRequestCache->pushRequest(ConfigSyncRequestCache::userKey(connKey));
+}
+
+/*
+  \internal
+
+    \breaf mark the global cache of the file dirty and request to sync it.
+*/
+void DSGConfigResource::requestSyncFile(const ResourceKey &resourceKey)
+{
+    m_dirtyFiles.insert(resourceKey);
+    if (Q_LIKELY(m_syncRequestCache))
+        m_syncRequestCache->pushRequest(ConfigSyncRequestCache::globalKey(resourceKey));
 }
 
 GenericResourceKey DSGConfigResource::key() const
@@ -420,23 +779,19 @@ GenericResourceKey DSGConfigResource::key() const
 
 void DSGConfigResource::removeConn(const ConnKey &connKey)
 {
-    if (auto conn = getConn(connKey)) {
-        m_conns.remove(connKey);
+    if (auto conn = takeConn(connKey))
         conn->deleteLater();
-    }
 
-    if (auto cache = getCache(connKey)) {
-        cache->save(m_localPrefix);
-        m_caches.remove(connKey);
+    if (auto cache = takeCache(connKey)) {
+        saveObject(connKey, cache, m_dirtyCaches.remove(connKey));
         delete cache;
     }
 
     const auto resourceKey = getResourceKey(connKey);
     if (auto file = getFile(resourceKey)) {
         if (!cacheExist(resourceKey)) {
-            file->save(m_localPrefix);
-            m_files.remove(resourceKey);
-            delete file;
+            removeFile(resourceKey);
+            retireFile(resourceKey, file);
         }
     }
 
@@ -451,47 +806,100 @@ bool DSGConfigResource::isEmptyConn() const
 void DSGConfigResource::save()
 {
     qDebug(cfLog, "Save resource's cache for [%s], and cache count:%d", qPrintable(m_key), m_caches.count());
-    for (auto item : m_files)
-        item->save(m_localPrefix);
+    for (auto iter = m_files.begin(); iter != m_files.end(); ++iter)
+        saveObject(iter.key(), iter.value(), m_dirtyFiles.contains(iter.key()));
+    m_dirtyFiles.clear();
 
-    for (auto item : m_caches)
-        item->save(m_localPrefix);
+    for (auto iter = m_caches.begin(); iter != m_caches.end(); ++iter)
+        saveObject(iter.key(), iter.value(), m_dirtyCaches.contains(iter.key()));
+    m_dirtyCaches.clear();
+
+    if (m_writer)
+        m_writer->drain();
 }
 
 void DSGConfigResource::save(const QString &appid)
 {
     const auto &resourceKey = getResourceKey(appid, m_key);
-    if (auto file = getFile(resourceKey))
-        file->save(m_localPrefix);
+    QStringList ids;
+    if (auto file = getFile(resourceKey)) {
+        if (m_dirtyFiles.remove(resourceKey)) {
+            saveObject(resourceKey, file, true);
+            ids << resourceKey;
+        }
+    }
+
+    const auto &caches = m_resourceCaches.value(resourceKey);
+    for (auto iter = caches.begin(); iter != caches.end(); ++iter) {
+        const auto &connKey = getConnectionKey(resourceKey, iter.key());
+        if (!m_dirtyCaches.remove(connKey))
+            continue;
 
-    for (auto item : cachesOfTheResource(resourceKey)) {
-        item->save(m_localPrefix);
+        saveObject(connKey, iter.value(), true);
+        ids << connKey;
+    }
+
+    // `sync` returns after the configuration is written.
+    if (m_writer) {
+        for (const auto &id : std::as_const(ids))
+            m_writer->wait(id);
     }
 }
 
 void DSGConfigResource::onGlobalValueChanged(const QString &key)
 {
     if (auto conn = qobject_cast<DSGConfigConn*>(sender())) {
-        const auto &resourceKey = getResourceKey(conn->key());
+        const auto &resourceKey = conn->resourceKey();
         doGlobalValueChanged(key, resourceKey);
     }
 }
 
+/*
+  \internal
+
+    \breaf handle the values changed by a batch request of the connection,
+    only one sync request is pushed for the user cache and the global cache respectively.
+*/
+void DSGConfigResource::onBatchValueChanged(const QStringList &keys)
+{
+    auto conn = qobject_cast<DSGConfigConn*>(sender());
+    if (!conn)
+        return;
+
+    const auto &resourceKey = conn->resourceKey();
+    if (!getFile(resourceKey))
+        return;
+
+    QStringList globalKeys;
+    QStringList userKeys;
+    for (const auto &key : keys) {
+        if (keyFlags(resourceKey, key).testFlag(DConfigFile::Global)) {
+            globalKeys << key;
+        } else {
+            userKeys << key;
+        }
+    }
+
+    if (!userKeys.isEmpty())
+        requestSyncCache(conn->key());
+
+    // per-key notifications don't push sync requests again in `onValueChanged`.
+    QScopedValueRollback<bool> notifying(m_notifyingBatch, true);
+    if (!globalKeys.isEmpty())
+        doGlobalValuesChanged(globalKeys, resourceKey);
+
+    for (const auto &key : std::as_const(userKeys))
+        emit conn->valueChanged(key);
+}
+
 /*!
  \brief 获取指定用户ID的所有连接
- 遍历所有连接，返回属于指定用户的连接键列表
+ 返回属于指定用户的连接键列表
  \a uid 用户ID
  \return 属于该用户的连接键列表
  */
 QList<ConnKey> DSGConfigResource::getConnectionsByUid(const uint uid) const
 {
-    QList<ConnKey> userConnections;
-    for (auto iter = m_conns.begin(); iter != m_conns.end(); ++iter) {
-        const ConnKey &connKey = iter.key();
-        const uint connUid = getConnectionKey(connKey);
-        if (connUid == uid) {
-            userConnections.append(connKey);
-        }
-    }
-    return userConnections;
+    const auto &userConnections = m_uidConns.value(uid);
+    return {userConnections.begin(), userConnections.end()};
 }
@@ -9,6 +9,9 @@
 #include <QObject>
 #include <QDBusObjectPath>
 #include <QDBusContext>
+#include <QHash>
+#include <QSet>
+#include <QPointer>
 
 DCORE_BEGIN_NAMESPACE
 class DConfigFile;
@@ -19,6 +22,42 @@ DCORE_END_NAMESPACE
 DCORE_USE_NAMESPACE
 class DSGConfigConn;
 class ConfigSyncRequestCache;
+class PeerCredentialsCache;
+class ConfigPersistenceWriter;
+class ConfigJournal;
+class ConfigMetaStore;
+class ConfigDependencyGraph;
+class ConfigStatistics;
+class QDBusConnection;
+class QDBusMessage;
+
+/**
+ * @brief The ConfigMetaItem struct
+ * 配置项在描述文件中的标志、权限及可见性
+ */
+struct ConfigMetaItem {
+    DConfigFile::Flags flags;
+    DConfigFile::Permissions permissions;
+    DConfigFile::Visibility visibility;
+};
+// key -> item, rebuilt only when the DConfigFile is created or swapped by `reparse`.
+using ConfigMetaIndex = QHash<QString, ConfigMetaItem>;
+
+/**
+ * @brief The ConfigMetaDiff struct
+ * 重新解析前后描述文件的差异，只有这些配置项的值可能变化
+ */
+struct ConfigMetaDiff {
+    QStringList added;
+    QStringList removed;
+    // default value (including the override), flags, permissions or serial is changed.
+    QStringList changed;
+    // permissions are changed from readwrite to readonly, their cached values are dropped.
+    QStringList readOnly;
+
+    bool isEmpty() const { return added.isEmpty() && removed.isEmpty() && changed.isEmpty(); }
+};
+
 /**
  * @brief The DSGConfigResource class
  * 管理单个资源的所有链接和链接需要的配置功能，包括不同应用和应用间的配置
@@ -35,6 +74,8 @@ public:
     GenericResourceKey key() const;
     DConfigFile *getFile(const ResourceKey &key) const;
     DConfigCache *getCache(const ConnKey &key) const;
+    const ConfigMetaIndex *metaIndex(const ResourceKey &key) const;
+    DConfigFile::Flags keyFlags(const ResourceKey &resourceKey, const QString &key) const;
 
     DSGConfigConn *getConn(const QString &appid, const uint uid) const;
     DSGConfigConn *getConn(const ConnKey &key) const;
@@ -45,6 +86,7 @@ public:
     int connSize() const;
 
     bool fallbackToGenericConfig() const;
+    void invalidateFallbackToGenericConfig();
     DConfigCache *noAppidCache(const uint uid) const;
     DConfigFile *noAppidFile() const;
 
@@ -52,8 +94,20 @@ public:
     void save(const QString &appid);
 
     bool reparse(const QString &appid);
+    static ConfigMetaDiff metaDiff(DConfigMeta *oldMeta, DConfigMeta *newMeta);
 
     void setSyncRequestCache(ConfigSyncRequestCache *cache);
+    void setCredentialsCache(PeerCredentialsCache *cache);
+    PeerCredentialsCache *credentialsCache() const;
+    void setPersistenceWriter(ConfigPersistenceWriter *writer);
+    void setJournal(ConfigJournal *journal);
+    void setMetaStore(ConfigMetaStore *store);
+    void setDependencyGraph(ConfigDependencyGraph *graph);
+    void setStatistics(ConfigStatistics *statistics);
+    ConfigStatistics *statistics() const;
+    void appendJournal(const ConnKey &connKey, const QString &key, const QVariant &value, const QString &callerAppid);
+    bool replyAfterJournalSynced(const QDBusConnection &connection, const QDBusMessage &message);
+    bool restoreValue(const QString &appid, const uint uid, const QString &key, const QVariant &value, const QString &callerAppid);
     void doSyncConfigCache(const ConfigCacheKey &key);
 
     QList<ConnKey> getConnectionsByUid(const uint uid) const;
@@ -66,16 +120,30 @@ Q_SIGNALS:
 private Q_SLOTS:
     void onValueChanged(const QString &key);
     void onGlobalValueChanged(const QString &key);
+    void onBatchValueChanged(const QStringList &keys);
     void onReleaseChanged(const ConnServiceName &service);
 
 private:
-    void repareCache(DConfigCache *cache, DConfigMeta *oldMeta, DConfigMeta *newMeta);
+    bool repareCache(DConfigCache *cache, const ConfigMetaDiff &diff);
+
+    void requestSyncCache(const ConnKey &connKey);
+    void requestSyncFile(const ResourceKey &resourceKey);
+    template<class T>
+    void saveObject(const QString &id, T *object, bool dirty);
 
     void doUpdateGenericConfigValueChanged(const QString &key, const ConnKey &connKey);
 
     void doGlobalValueChanged(const QString &key, const ResourceKey &resourceKey);
+    void doGlobalValuesChanged(const QStringList &keys, const ResourceKey &resourceKey);
 
     DConfigFile *getOrCreateFile(const QString &appid);
+    void insertFile(const ResourceKey &key, DConfigFile *file);
+    void removeFile(const ResourceKey &key);
+    void retireFile(const ResourceKey &key, DConfigFile *file);
+    void insertCache(const ConnKey &key, DConfigCache *cache);
+    DConfigCache *takeCache(const ConnKey &key);
+    void insertConn(const ConnKey &key, DSGConfigConn *conn);
+    DSGConfigConn *takeConn(const ConnKey &key);
     DConfigCache *createCache(const QString &appid, const uint uid);
     DConfigCache *getOrCreateCache(const QString &appid, const uint uid);
     QList<DSGConfigConn *> specificAppConns() const;
@@ -90,8 +158,31 @@ private:
     QString m_localPrefix;
 
     QMap<ResourceKey, DConfigFile *> m_files;
+    QHash<ResourceKey, ConfigMetaIndex> m_metaIndexes;
     QMap<ConnKey, DConfigCache *> m_caches;
     QMap<ConnKey, DSGConfigConn *> m_conns;
+    // secondary indexes of `m_caches` and `m_conns`, grouped by ResourceKey and uid.
+    QHash<ResourceKey, QMap<uint, DConfigCache *>> m_resourceCaches;
+    QHash<ResourceKey, QMap<uint, DSGConfigConn *>> m_resourceConns;
+    QHash<uint, QSet<ConnKey>> m_uidConns;
+    // caches and global files changed since they were saved.
+    QSet<ConnKey> m_dirtyCaches;
+    QSet<ResourceKey> m_dirtyFiles;
 
     ConfigSyncRequestCache *m_syncRequestCache = nullptr;
+    PeerCredentialsCache *m_credentialsCache = nullptr;
+    // resource deleted later may outlive the writer, it saves synchronously then.
+    QPointer<ConfigPersistenceWriter> m_writer;
+    QPointer<ConfigJournal> m_journal;
+    // parsed files are kept by the store after released.
+    QPointer<ConfigMetaStore> m_metaStore;
+    // meta and override files the loaded files depend on.
+    QPointer<ConfigDependencyGraph> m_dependencies;
+    QPointer<ConfigStatistics> m_statistics;
+
+    // set while `onBatchValueChanged` emits the per-key notifications.
+    bool m_notifyingBatch = false;
+    // memoized result of `fallbackToGenericConfig`, reset when generic meta is updated.
+    mutable bool m_fallbackResolved = false;
+    mutable bool m_canFallbackToGeneric = false;
 };
@@ -6,19 +6,46 @@
 #include "dconfigresource.h"
 #include "dconfigconn.h"
 #include "dconfigrefmanager.h"
+#include "dconfigcredentials.h"
+#include "dconfigwriter.h"
+#include "dconfigjournal.h"
+#include "dconfigwatcher.h"
+#include "dconfigmetastore.h"
+#include "dconfigchannel.h"
+#include "dconfigloader.h"
+#include "dconfigdependency.h"
+#include "dconfigstats.h"
 #include <QDBusMessage>
 #include <QDBusConnection>
 #include <QDBusConnectionInterface>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
 #include <QCoreApplication>
 #include <QDebug>
 #include <QLoggingCategory>
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QTimer>
+#include <QCryptographicHash>
 
 #include "configmanager_adaptor.h"
+#include "configmanagerstats_adaptor.h"
 
 #define DSG_CONFIG "org.desktopspec.ConfigManager"
 
+static constexpr quint32 SignatureSnapshotMagic = 0x44534753; // "DSGS"
+static constexpr quint32 SignatureSnapshotVersion = 2;
+// files modified in place don't change the directory, they are verified when idle if the last full scan is stale.
+static constexpr int SignatureVerifyDelay = 5000;
+static constexpr qint64 MaxFullScanInterval = 24 * 60 * 60 * 1000;
+// records of cold resources are dropped when saving the access profile.
+static constexpr int MaxAccessProfileCount = 1024;
+static constexpr quint32 HandoffMagic = 0x44534748; // "DSGH"
+static constexpr quint32 HandoffVersion = 1;
+
 #ifndef QT_DEBUG
 Q_LOGGING_CATEGORY(cfLog, "dsg.config", QtInfoMsg);
 #else
@@ -37,11 +64,31 @@ DSGConfigServer::DSGConfigServer(QObject *parent)
       m_watcher(nullptr),
       m_refManager(new RefManager(this))
     , m_syncRequestCache(new ConfigSyncRequestCache(this))
+    , m_credentialsCache(new PeerCredentialsCache(this))
+    , m_writer(new ConfigPersistenceWriter(this))
+    , m_journal(new ConfigJournal(this))
+    , m_fileWatcher(new ConfigFileWatcher(this))
+    , m_metaStore(new ConfigMetaStore(this))
+    , m_directChannels(new ConfigDirectChannels(this, m_credentialsCache, this))
+    , m_fileLoader(new ConfigFileLoader(this))
+    , m_dependencies(new ConfigDependencyGraph(this))
+    , m_statistics(new ConfigStatistics(this))
+    , m_preloadTimer(new QTimer(this))
 {
+    m_fileLoader->setPersistenceWriter(m_writer);
+    m_writer->setStatistics(m_statistics);
+    // zero timer runs when there is no pending event, it's started again after the file is loaded.
+    m_preloadTimer->setInterval(0);
+    m_preloadTimer->setSingleShot(true);
+    connect(m_preloadTimer, &QTimer::timeout, this, &DSGConfigServer::preloadNext);
     connect(this, &DSGConfigServer::releaseResource, this, &DSGConfigServer::onReleaseResource);
     connect(m_refManager, &RefManager::releaseResource, this, &DSGConfigServer::releaseResource);
     connect(this, &DSGConfigServer::tryExit, this, &DSGConfigServer::onTryExit);
     connect(m_syncRequestCache, &ConfigSyncRequestCache::syncConfigRequest, this, &DSGConfigServer::doSyncConfigCache);
+    connect(m_fileWatcher, &ConfigFileWatcher::filesChanged, this, &DSGConfigServer::onConfigureFilesChanged);
+    connect(m_fileWatcher, &ConfigFileWatcher::overflowed, this, &DSGConfigServer::reload);
+    connect(m_directChannels, &ConfigDirectChannels::closed, this, &DSGConfigServer::onDirectChannelClosed);
+    connect(m_fileLoader, &ConfigFileLoader::loaded, this, &DSGConfigServer::onConfigFileLoaded);
 }
 
 DSGConfigServer::~DSGConfigServer()
@@ -52,10 +99,42 @@ DSGConfigServer::~DSGConfigServer()
 
 void DSGConfigServer::exit()
 {
+    const bool initialized = m_initialized;
+    m_initialized = false;
+    if (initialized)
+        saveHandoff();
+
+    // the delayed replies are dropped, clients will acquire again from the next daemon.
+    m_fileLoader->waitForDone();
+    m_pendingAcquires.clear();
+    m_handoffReferences.clear();
+    m_directChannels->closeAll();
     m_refManager->destroy();
     qDeleteAll(m_resources);
     m_resources.clear();
+    m_uidResources.clear();
     m_syncRequestCache->clear();
+    m_preloadTimer->stop();
+    m_preloadQueue.clear();
+    m_preloadingKey.clear();
+    m_metaStore->clear();
+    // resources hand the snapshots of their files and caches over to the writer.
+    m_writer->drain();
+    if (m_journal->isOpen()) {
+        // confirm the checkpoints queued by the writer before the last one.
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+        markFailedObjectsUnsaved();
+        m_journal->seal();
+        m_journal->takeCheckpointedSegments();
+        const auto &segments = m_journal->confirmCheckpoint(m_journal->lastCheckpoint());
+        m_journal->close();
+        removeJournalSegments(segments);
+    }
+    m_credentialsCache->clear();
+    if (initialized) {
+        saveSignatureSnapshot();
+        m_accessProfile.save(accessProfilePath(), MaxAccessProfileCount);
+    }
 }
 
 /*
@@ -65,6 +144,7 @@ void DSGConfigServer::exit()
 bool DSGConfigServer::registerService()
 {
     (void) new DSGConfigAdaptor(this);
+    (void) new DSGConfigStatsAdaptor(this);
 
     QDBusConnection bus = QDBusConnection::systemBus();
     if (!bus.registerService(DSG_CONFIG)) {
@@ -84,10 +164,32 @@ bool DSGConfigServer::registerService()
 
 void DSGConfigServer::initialize()
 {
+    replayJournal();
+
     // Initialize file signatures to avoid unnecessary updates on first reload
     qCInfo(cfLog()) << "Initializing file signatures on service startup";
-    m_fileSignatures = allConfigureFileSignatures(m_localPrefix);
+    const bool snapshotLoaded = loadSignatureSnapshot();
+    if (!snapshotLoaded) {
+        m_fileSignatures = allConfigureFileSignatures(m_localPrefix, &m_directoryTimes);
+        m_lastFullScanTime = QDateTime::currentMSecsSinceEpoch();
+    }
     qCInfo(cfLog()) << "Initialized file signatures completed, size: " << m_fileSignatures.size();
+
+    // Changed files are updated by the watcher, `reload` is the fallback when it's unavailable.
+    const bool watching = m_fileWatcher->start(configureDirectories(m_localPrefix));
+    if (snapshotLoaded) {
+        // files modified in place while the daemon is down are found by the full scan,
+        // it's deferred and done at most once in the interval unless the watcher is unavailable.
+        const qint64 elapsed = QDateTime::currentMSecsSinceEpoch() - m_lastFullScanTime;
+        if (!watching || elapsed < 0 || elapsed > MaxFullScanInterval) {
+            qCInfo(cfLog()) << "Verify file signatures later, watching:" << watching << "elapsed since the last full scan:" << elapsed;
+            QTimer::singleShot(SignatureVerifyDelay, this, &DSGConfigServer::reload);
+        }
+    }
+
+    restoreHandoff();
+    startPreload();
+    m_initialized = true;
 }
 
 /*!
@@ -121,6 +223,77 @@ int DSGConfigServer::delayReleaseTime() const
     return m_refManager->delayReleaseTime();
 }
 
+/*!
+ \brief 设置同步缓存前等待新请求的时间，没有新请求时在此时间后同步
+ \a ms 等待时间,单位为毫秒
+ */
+void DSGConfigServer::setSyncDelayTime(const int ms)
+{
+    if (ms < 0) {
+        QString errorMsg = QString("Negative values are not supported for sync delay time.");
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::InvalidArgs, errorMsg);
+        qCWarning(cfLog()) << qPrintable(errorMsg);
+        return;
+    }
+    m_syncRequestCache->setDelaySyncTime(ms);
+}
+
+int DSGConfigServer::syncDelayTime() const
+{
+    return m_syncRequestCache->delaySyncTime();
+}
+
+/*!
+ \brief 设置同步请求等待的最长时间，持续有新请求时最迟在此时间后同步
+ \a ms 最长等待时间,单位为毫秒
+ */
+void DSGConfigServer::setSyncMaxStaleness(const int ms)
+{
+    if (ms < 0) {
+        QString errorMsg = QString("Negative values are not supported for sync max staleness.");
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::InvalidArgs, errorMsg);
+        qCWarning(cfLog()) << qPrintable(errorMsg);
+        return;
+    }
+    m_syncRequestCache->setMaxSyncStaleness(ms);
+}
+
+int DSGConfigServer::syncMaxStaleness() const
+{
+    return m_syncRequestCache->maxSyncStaleness();
+}
+
+/*!
+ \brief 设置每次同步的最少请求数量，到期的请求总是在同一次同步
+ \a count 请求数量
+ */
+void DSGConfigServer::setSyncBatchCount(const int count)
+{
+    if (count <= 0) {
+        QString errorMsg = QString("Only positive values are supported for sync batch count.");
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::InvalidArgs, errorMsg);
+        qCWarning(cfLog()) << qPrintable(errorMsg);
+        return;
+    }
+    m_syncRequestCache->setBatchCount(count);
+}
+
+int DSGConfigServer::syncBatchCount() const
+{
+    return m_syncRequestCache->batchCount();
+}
+
+/*!
+ \brief 等待同步的请求数量
+ */
+int DSGConfigServer::syncQueueDepth() const
+{
+    return m_syncRequestCache->requestsCount();
+}
+
 void DSGConfigServer::enableVerboseLogging()
 {
     QByteArrayList rules{QString("%1.debug=true").arg(cfLog().categoryName()).toLocal8Bit()};
@@ -154,19 +327,9 @@ void DSGConfigServer::removeUserData(const uint &uid)
     qCInfo(cfLog()) << QString("Starting to remove user data for UID %1").arg(uid);
 
     // 收集要删除的连接
-    QList<ConnKey> connectionsToRemove;
-    for (auto iter = m_resources.begin(); iter != m_resources.end(); ++iter) {
-        auto resource = iter.value();
-        if (!resource)
-            continue;
-
-        // 获取该用户在此资源中的所有连接
-        const QList<ConnKey> userConnections = resource->getConnectionsByUid(uid);
-        connectionsToRemove.append(userConnections);
-
-        for (const ConnKey &connKey : userConnections) {
-            qCDebug(cfLog()) << QString("Found connection to remove: %1").arg(connKey);
-        }
+    const QList<ConnKey> connectionsToRemove = connectionsByUid(uid);
+    for (const ConnKey &connKey : connectionsToRemove) {
+        qCDebug(cfLog()) << QString("Found connection to remove: %1").arg(connKey);
     }
 
     // 逐个删除连接和相关数据
@@ -177,6 +340,7 @@ void DSGConfigServer::removeUserData(const uint &uid)
         if (resource) {
             // 删除连接，这会自动保存并删除相关的缓存和配置文件
             resource->removeConn(connKey);
+            removeUserConnection(connKey);
             removedCount++;
 
             qCInfo(cfLog()) << QString("Removed connection: %1").arg(connKey);
@@ -190,7 +354,8 @@ void DSGConfigServer::removeUserData(const uint &uid)
         }
         }
 
-    // 删除文件系统中的用户配置目录
+    // 等待移除的缓存保存完成，再删除文件系统中的用户配置目录
+    m_writer->drain();
     const QString userConfigBasePath = QString("%1/%2").arg(m_localPrefix).arg(configPrefixPath());
     if (!userConfigBasePath.isEmpty()) {
         const QString userCacheDir = QString("%1/%2").arg(userConfigBasePath).arg(uid);
@@ -231,8 +396,16 @@ int DSGConfigServer::resourceSize() const
  */
 QDBusObjectPath DSGConfigServer::acquireManager(const QString &appid, const QString &name, const QString &subpath)
 {
-    const auto &service = calledFromDBus() ? message().service() : "test.service";
-    const uint &uid = calledFromDBus() ? connection().interface()->serviceUid(service).value() : TestUid;
+    uint uid = TestUid;
+    if (calledFromDBus()) {
+        const auto &service = PeerCredentialsCache::serviceName(connection(), message());
+        if (!m_credentialsCache->uid(connection(), service, uid)) {
+            QString errorMsg = QString("Can't get the credentials of the service [%1].").arg(service);
+            sendErrorReply(QDBusError::AccessDenied, errorMsg);
+            qWarning() << qPrintable(errorMsg);
+            return QDBusObjectPath();
+        }
+    }
     return acquireManagerV2(uid, appid, name, subpath);
 }
 
@@ -246,17 +419,262 @@ QDBusObjectPath DSGConfigServer::acquireManager(const QString &appid, const QStr
  */
 QDBusObjectPath DSGConfigServer::acquireManagerV2(const uint &uid, const QString &appid, const QString &name, const QString &subpath)
 {
-    struct passwd *pw = getpwuid(uid);
-    if (!pw) {
-        QString errorMsg = QString("User with UID %1 does not exist.").arg(uid);
+    ConfigLatencyTimer timer(m_statistics, ConfigStatistics::AcquireManager);
+    const auto &service = calledFromDBus() ? PeerCredentialsCache::serviceName(connection(), message()) : "test.service";
+    if (calledFromDBus() && deferAcquire(service, uid, appid, name, subpath)) {
+        // it's recorded when replied.
+        timer.cancel();
+        return QDBusObjectPath();
+    }
+
+    QString errorMsg;
+    auto conn = acquireConnection(service, uid, appid, name, subpath, errorMsg);
+    if (!conn) {
         if (calledFromDBus())
             sendErrorReply(QDBusError::Failed, errorMsg);
+
         qWarning() << qPrintable(errorMsg);
         return QDBusObjectPath();
     }
 
-    const auto &service = calledFromDBus() ? message().service() : "test.service";
+    return QDBusObjectPath(conn->path());
+}
+
+/*!
+ \brief 为服务获取配置连接并增加引用，系统总线及直连通道共用
+ \a service 服务名称,关联特定进程
+ \a errorMsg 失败时的错误信息
+ \return 配置连接，失败时返回空
+ */
+DSGConfigConn *DSGConfigServer::acquireConnection(const ConnServiceName &service, const uint uid, const QString &appid, const QString &name, const QString &subpath, QString &errorMsg)
+{
+    struct passwd *pw = getpwuid(uid);
+    if (!pw) {
+        errorMsg = QString("User with UID %1 does not exist.").arg(uid);
+        return nullptr;
+    }
+
     qCDebug(cfLog, "AcquireManager service:%s, uid:%d, appid:%s", qPrintable(service), uid, qPrintable(appid));
+    auto conn = getOrCreateConn(uid, appid, name, subpath, errorMsg);
+    if (!conn)
+        return nullptr;
+
+    // the direct channel's peer is watched by the channel itself.
+    if (!PeerCredentialsCache::isPeerService(service))
+        addConnWatchedService(service);
+    m_refManager->refResource(service, conn->key());
+    m_accessProfile.record(outerAppidToInner(appid), name, subpath);
+
+    return conn;
+}
+
+/*
+  \internal
+
+    \breaf Delay the reply if the configuration file isn't parsed, it's parsed on the worker
+    and the acquires of the same file share the parsing, other requests aren't blocked by it.
+*/
+bool DSGConfigServer::deferAcquire(const ConnServiceName &service, const uint uid, const QString &appid, const QString &name, const QString &subpath)
+{
+    const auto &innerAppid = outerAppidToInner(appid);
+    const auto &genericResourceKey = getGenericResourceKey(name, subpath);
+    const auto &resourceKey = getResourceKey(innerAppid, genericResourceKey);
+    const auto resource = resourceObject(genericResourceKey);
+    if ((resource && resource->getFile(resourceKey)) || m_metaStore->contains(resourceKey))
+        return false;
+
+    setDelayedReply(true);
+    PendingAcquire pending{message(), connection().name(), service, uid, appid, name, subpath, QElapsedTimer()};
+    pending.timer.start();
+    m_pendingAcquires[resourceKey] << pending;
+    // the acquire is dropped if the client exits before the file is loaded.
+    watchService(connection(), service);
+    if (!m_fileLoader->load(innerAppid, name, subpath, m_localPrefix))
+        qCDebug(cfLog, "Wait for the configuration file being loaded:%s, service:%s.", qPrintable(resourceKey), qPrintable(service));
+    return true;
+}
+
+/*
+  \internal
+
+    \breaf Drop the acquires of the exited client, the references would never be released.
+*/
+void DSGConfigServer::removePendingAcquires(const ConnServiceName &service)
+{
+    for (auto iter = m_pendingAcquires.begin(); iter != m_pendingAcquires.end(); ++iter) {
+        auto &pendings = iter.value();
+        for (auto item = pendings.begin(); item != pendings.end();) {
+            if (item->service == service) {
+                qCDebug(cfLog, "Skip the acquire of the exited service:%s.", qPrintable(service));
+                item = pendings.erase(item);
+            } else {
+                ++item;
+            }
+        }
+    }
+    for (auto iter = m_handoffReferences.begin(); iter != m_handoffReferences.end(); ++iter) {
+        auto &references = iter.value();
+        for (auto item = references.begin(); item != references.end();) {
+            if (item->service == service) {
+                qCDebug(cfLog, "Skip the handoff reference of the exited service:%s.", qPrintable(service));
+                item = references.erase(item);
+            } else {
+                ++item;
+            }
+        }
+    }
+}
+
+/*
+  \internal
+
+    \breaf Reply the acquires waiting for the configuration file, it's loaded synchronously
+    if it's changed while loading or can't be loaded, then the error is the same as before.
+*/
+void DSGConfigServer::onConfigFileLoaded(const ResourceKey &key, DConfigFile *file)
+{
+    const auto resource = resourceObject(getGenericResourceKeyByResourceKey(key));
+    if (file) {
+        if (resource && resource->getFile(key)) {
+            delete file;
+        } else {
+            m_metaStore->put(key, file);
+        }
+    }
+
+    if (key == m_preloadingKey) {
+        m_preloadingKey.clear();
+        if (!file) {
+            qCDebug(cfLog()) << "Remove the access record of the not existing resource:" << key;
+            m_accessProfile.remove(key);
+        }
+        m_preloadTimer->start();
+    }
+
+    restoreReferences(key);
+
+    const auto pendings = m_pendingAcquires.take(key);
+    for (const auto &pending : pendings) {
+        QDBusConnection bus(pending.connectionName);
+        QString errorMsg;
+        auto conn = acquireConnection(pending.service, pending.uid, pending.appid, pending.name, pending.subpath, errorMsg);
+        if (!conn) {
+            bus.send(pending.message.createErrorReply(QDBusError::Failed, errorMsg));
+            qWarning() << qPrintable(errorMsg);
+            continue;
+        }
+        bus.send(pending.message.createReply(QVariant::fromValue(QDBusObjectPath(conn->path()))));
+        m_statistics->record(ConfigStatistics::AcquireManager, pending.timer.nsecsElapsed() / 1000);
+    }
+}
+
+/*!
+ \brief 获取服务的运行统计
+ \return 各方法的调用次数及耗时分布（单位为微秒）、保存写入的字节数及各队列的长度
+ */
+QVariantMap DSGConfigServer::statistics()
+{
+    auto result = m_statistics->toMap();
+    int pendingAcquireCount = 0;
+    for (const auto &item : std::as_const(m_pendingAcquires))
+        pendingAcquireCount += item.size();
+
+    QVariantMap queues;
+    queues["writerPending"] = m_writer->pendingCount();
+    queues["syncPending"] = syncQueueDepth();
+    queues["loaderPending"] = m_fileLoader->pendingCount();
+    queues["acquirePending"] = pendingAcquireCount;
+    queues["credentials"] = m_credentialsCache->size();
+    queues["metaStore"] = m_metaStore->size();
+    queues["directChannels"] = m_directChannels->count();
+    queues["resources"] = m_resources.size();
+    queues["loadedFiles"] = m_dependencies->size();
+    result["queues"] = queues;
+    return result;
+}
+
+/*!
+ \brief 获取指定统计项的耗时分布
+ \a name 统计项名称，如acquireManagerV2、value、setValue、reset、release、update、reparse及syncWrite
+ \return 百分位耗时及非空区间的上界和计数，单位为微秒
+ */
+QVariantMap DSGConfigServer::latencyHistogram(const QString &name)
+{
+    const auto metric = ConfigStatistics::metric(name);
+    if (metric == ConfigStatistics::MetricCount) {
+        QString errorMsg = QString("It's illegal statistics name [%1].").arg(name);
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::InvalidArgs, errorMsg);
+
+        qWarning() << qPrintable(errorMsg);
+        return QVariantMap();
+    }
+
+    const auto &histogram = m_statistics->histogram(metric);
+    auto result = histogram.toMap();
+    const auto &buckets = histogram.buckets();
+    for (auto iter = buckets.begin(); iter != buckets.end(); ++iter)
+        result.insert(iter.key(), iter.value());
+    return result;
+}
+
+/*!
+ \brief 清空运行统计，重新开始记录
+ */
+void DSGConfigServer::resetStatistics()
+{
+    qCInfo(cfLog()) << "Reset statistics.";
+    m_statistics->reset();
+}
+
+/*!
+ \brief 为调用者打开点对点的直连通道，通道只能连接一次，对端以调用者的身份获取配置连接
+ \return 通道的地址，失败时返回空
+ */
+QString DSGConfigServer::openDirectChannel()
+{
+    PeerCredentials credentials;
+    if (calledFromDBus()) {
+        const auto &service = PeerCredentialsCache::serviceName(connection(), message());
+        if (!m_credentialsCache->credentials(connection(), service, credentials)) {
+            QString errorMsg = QString("Can't get the credentials of the service [%1].").arg(service);
+            sendErrorReply(QDBusError::AccessDenied, errorMsg);
+            qWarning() << qPrintable(errorMsg);
+            return QString();
+        }
+    } else {
+        credentials.uid = TestUid;
+    }
+
+    QString errorMsg;
+    const auto &address = m_directChannels->open(credentials, errorMsg);
+    if (address.isEmpty()) {
+        if (calledFromDBus())
+            sendErrorReply(QDBusError::Failed, errorMsg);
+
+        qWarning() << qPrintable(errorMsg);
+    }
+    return address;
+}
+
+/*
+  \internal
+
+    \breaf Release references of the direct channel's peer when it's disconnected.
+*/
+void DSGConfigServer::onDirectChannelClosed(const ConnServiceName &service)
+{
+    qCInfo(cfLog, "Remove direct channel service:%s", qPrintable(service));
+    m_refManager->releaseService(service);
+}
+
+/*
+  \internal
+
+    \breaf Load the resource and create the connection if they don't exist, `errorMsg` is set when failed.
+*/
+DSGConfigConn *DSGConfigServer::getOrCreateConn(const uint uid, const QString &appid, const QString &name, const QString &subpath, QString &errorMsg)
+{
     const QString &innerAppid = outerAppidToInner(appid);
     const GenericResourceKey &genericResourceKey = getGenericResourceKey(name, subpath);
     DSGConfigResource *resource = resourceObject(genericResourceKey);
@@ -264,44 +682,39 @@ QDBusObjectPath DSGConfigServer::acquireManagerV2(const uint &uid, const QString
     if (!resource) {
         resource = new DSGConfigResource(name, subpath, m_localPrefix);
         resource->setSyncRequestCache(m_syncRequestCache);
+        resource->setCredentialsCache(m_credentialsCache);
+        resource->setPersistenceWriter(m_writer);
+        resource->setJournal(m_journal);
+        resource->setMetaStore(m_metaStore);
+        resource->setDependencyGraph(m_dependencies);
+        resource->setStatistics(m_statistics);
         resourceHolder.reset(resource);
     }
     bool loadStatus = resource->load(innerAppid);
     if (!loadStatus) {
         //error
-        QString errorMsg = QString("Can't load resource: %1, for the appid:[%2].").arg(genericResourceKey).arg(appid);
-        if (calledFromDBus())
-            sendErrorReply(QDBusError::Failed, errorMsg);
-
-        qWarning() << qPrintable(errorMsg);
-        return QDBusObjectPath();
+        errorMsg = QString("Can't load resource: %1, for the appid:[%2].").arg(genericResourceKey).arg(appid);
+        return nullptr;
     }
 
     auto conn = resource->getConn(innerAppid, uid);
     if (!conn) {
         conn = resource->createConn(innerAppid, uid);
         if (!conn) {
-            QString errorMsg = QString("Can't register Connection object:[%1], for the appid:[%2].").arg(genericResourceKey).arg(appid);
-            if (calledFromDBus())
-                sendErrorReply(QDBusError::Failed, errorMsg);
-
-            qWarning() << qPrintable(errorMsg);
-            return QDBusObjectPath();
+            errorMsg = QString("Can't register Connection object:[%1], for the appid:[%2].").arg(genericResourceKey).arg(appid);
+            return nullptr;
         }
         qCInfo(cfLog, "Created connection:%s", qPrintable(conn->path()));
     } else {
         qCInfo(cfLog, "Reuse connection:%s", qPrintable(conn->path()));
     }
 
+    m_uidResources[uid].insert(genericResourceKey);
     if (resourceHolder) {
         m_resources.insert(genericResourceKey, resourceHolder.release());
         QObject::connect(resource, &DSGConfigResource::releaseConn, this, &DSGConfigServer::onReleaseChanged);
     }
-
-    addConnWatchedService(service);
-    m_refManager->refResource(service, conn->key());
-
-    return QDBusObjectPath(conn->path());
+    return conn;
 }
 
 /*!
@@ -329,6 +742,7 @@ void DSGConfigServer::onReleaseResource(const ConnKey &connKey)
         return;
     qCInfo(cfLog, "Remove connection:%s", qPrintable(connKey));
     resource->removeConn(connKey);
+    removeUserConnection(connKey);
 
     if (resource->isEmptyConn()) {
         qCInfo(cfLog, "Remove resource:%s", qPrintable(resourceKey));
@@ -365,6 +779,164 @@ void DSGConfigServer::doSyncConfigCache(const ConfigSyncBatchRequest &request)
             resource->doSyncConfigCache(key);
         }
     }
+    checkpointJournal();
+}
+
+QString DSGConfigServer::journalDirectory() const
+{
+    return QString("%1/%2/journal").arg(m_localPrefix).arg(configPrefixPath());
+}
+
+/*!
+ \brief 重放上次服务退出前未保存的配置项修改，并打开新的日志段
+ */
+void DSGConfigServer::replayJournal()
+{
+    m_keepJournal = false;
+    const auto &directory = journalDirectory();
+    const auto &segments = ConfigJournal::segments(directory);
+    if (!segments.isEmpty()) {
+        qCInfo(cfLog()) << "Replay journal segments, count:" << segments.size();
+        QMap<GenericResourceKey, DSGConfigResource *> resources;
+        int restoredCount = 0;
+        for (const auto &segment : segments) {
+            for (const auto &record : ConfigJournal::readSegment(segment)) {
+                const auto &resourceKey = getGenericResourceKey(record.name, record.subpath);
+                auto resource = resources.value(resourceKey);
+                if (!resource) {
+                    resource = new DSGConfigResource(record.name, record.subpath, m_localPrefix);
+                    resource->setPersistenceWriter(m_writer);
+                    resources.insert(resourceKey, resource);
+                }
+                if (resource->restoreValue(record.appid, record.uid, record.key, record.value, record.callerAppid))
+                    restoredCount++;
+            }
+        }
+        // files and caches are saved when the resource is destroyed.
+        qDeleteAll(resources);
+        m_writer->drain();
+        const auto &failedIds = m_writer->takeFailedIds();
+        if (failedIds.isEmpty()) {
+            removeJournalSegments(segments);
+        } else {
+            // newer segments are appended behind them, all are replayed in order on the next startup.
+            qCWarning(cfLog()) << "Keep journal segments for replaying because of saving failure, objects:" << failedIds;
+            m_keepJournal = true;
+        }
+
+        qCInfo(cfLog()) << "Replay journal completed, restored values count:" << restoredCount;
+    }
+    m_journal->open(directory);
+}
+
+/*!
+ \brief 每批同步请求提交保存后封存当前日志段，删除记录修改的对象都已保存的日志段
+ */
+void DSGConfigServer::checkpointJournal()
+{
+    m_journal->seal();
+    const auto &segments = m_journal->takeCheckpointedSegments();
+    if (segments.isEmpty())
+        return;
+
+    // snapshots are written in order on the writer, the checkpoint is confirmed after the previous snapshots.
+    const auto checkpoint = m_journal->lastCheckpoint();
+    m_writer->post(segments.first(), [this, checkpoint]() {
+        QMetaObject::invokeMethod(this, [this, checkpoint]() {
+            confirmJournalCheckpoint(checkpoint);
+        }, Qt::QueuedConnection);
+    });
+}
+
+/*
+  \internal
+
+    \breaf the snapshots posted before the checkpoint are written, the segments failed to be
+    saved are kept until the objects are saved again, others are removed in order.
+*/
+void DSGConfigServer::confirmJournalCheckpoint(qint64 checkpoint)
+{
+    if (!m_journal->isOpen())
+        return;
+
+    markFailedObjectsUnsaved();
+    removeJournalSegments(m_journal->confirmCheckpoint(checkpoint));
+}
+
+/*
+  \internal
+
+    \breaf the journal segments are needed until the objects failed to be written are saved again.
+*/
+void DSGConfigServer::markFailedObjectsUnsaved()
+{
+    const auto &failedIds = m_writer->takeFailedIds();
+    if (failedIds.isEmpty())
+        return;
+
+    qCWarning(cfLog()) << "Keep journal segments for replaying because of saving failure, objects:" << failedIds;
+    for (const auto &id : failedIds)
+        m_journal->markUnsaved(id);
+}
+
+void DSGConfigServer::removeJournalSegments(const QStringList &segments)
+{
+    // segments are replayed in order, none is removed after a replaying failure.
+    if (m_keepJournal)
+        return;
+
+    for (const auto &segment : segments)
+        QFile::remove(segment);
+}
+
+/*!
+ \brief 获取指定用户ID在所有资源中的连接
+ 只访问该用户使用的资源，同时清理已移除资源的索引
+ \a uid 用户ID
+ \return 属于该用户的连接键列表
+ */
+QList<ConnKey> DSGConfigServer::connectionsByUid(const uint uid)
+{
+    QList<ConnKey> result;
+    auto iter = m_uidResources.find(uid);
+    if (iter == m_uidResources.end())
+        return result;
+
+    for (auto resourceIter = iter->begin(); resourceIter != iter->end();) {
+        auto resource = m_resources.value(*resourceIter);
+        const auto &userConnections = resource ? resource->getConnectionsByUid(uid) : QList<ConnKey>();
+        if (userConnections.isEmpty()) {
+            resourceIter = iter->erase(resourceIter);
+            continue;
+        }
+        result << userConnections;
+        ++resourceIter;
+    }
+    if (iter->isEmpty())
+        m_uidResources.erase(iter);
+
+    return result;
+}
+
+/*
+  \internal
+
+    \breaf drop the resource from the uid index when the user has no connection on it.
+*/
+void DSGConfigServer::removeUserConnection(const ConnKey &connKey)
+{
+    const uint uid = getConnectionKey(connKey);
+    auto iter = m_uidResources.find(uid);
+    if (iter == m_uidResources.end())
+        return;
+
+    const GenericResourceKey &resourceKey = getGenericResourceKey(connKey);
+    auto resource = m_resources.value(resourceKey);
+    if (!resource || resource->getConnectionsByUid(uid).isEmpty()) {
+        iter->remove(resourceKey);
+        if (iter->isEmpty())
+            m_uidResources.erase(iter);
+    }
 }
 
 ResourceKey DSGConfigServer::getResourceKeyByConfigCache(const ConfigCacheKey &key)
@@ -437,6 +1009,7 @@ bool DSGConfigServer::isConfigurePath(const QString &path, const QString &appId)
  */
 void DSGConfigServer::update(const QString &path)
 {
+    ConfigLatencyTimer timer(m_statistics, ConfigStatistics::Update);
     qCInfo(cfLog()) << "Update resource:" << path;
 
     const auto &configureInfo = getConfigureIdByPath(path);
@@ -454,19 +1027,47 @@ void DSGConfigServer::update(const QString &path)
     }
 
 
-    const GenericResourceKey resourceKey = getGenericResourceKey(configureInfo.resource, configureInfo.subpath);
-    if (auto resource = resourceObject(resourceKey)) {
+    // files of all applications and subpaths may depend on the generic meta and overrides.
+    const auto dependsOn = [&configureInfo](const ResourceKey &key) {
+        return ConfigDependencyGraph::dependsOn(configureInfo, key);
+    };
+    m_metaStore->invalidate(dependsOn);
+    m_fileLoader->invalidate(dependsOn);
+
+    if (configureInfo.appid.isEmpty()) {
+        // generic meta may be added or removed.
+        QSet<GenericResourceKey> invalidatedResources;
+        for (const auto &key : m_dependencies->dependentFiles(configureInfo)) {
+            const auto &genericResourceKey = getGenericResourceKeyByResourceKey(key);
+            if (invalidatedResources.contains(genericResourceKey))
+                continue;
+
+            invalidatedResources.insert(genericResourceKey);
+            if (auto resource = resourceObject(genericResourceKey))
+                resource->invalidateFallbackToGenericConfig();
+        }
+    }
+
+    QStringList failedFiles;
+    const auto &affectedFiles = m_dependencies->affectedFiles(path);
+    for (const auto &key : affectedFiles) {
+        auto resource = resourceObject(getGenericResourceKeyByResourceKey(key));
+        if (!resource)
+            continue;
+
         qCInfo(cfLog, "Updated the resouce:[%s], for the appid:[%s].",
-               qPrintable(resourceKey),
-               qPrintable(configureInfo.appid));
-        const auto &innerAppid = outerAppidToInner(configureInfo.appid);
-        if (!resource->reparse(innerAppid)) {
-            QString errorMsg = QString("Update the resource path[%1] error.").arg(path);
-            if (calledFromDBus()) {
-                sendErrorReply(QDBusError::Failed, errorMsg);
-            }
-            qWarning() << qPrintable(errorMsg);
+               qPrintable(resource->key()),
+               qPrintable(getAppidByResourceKey(key)));
+        if (!resource->reparse(getAppidByResourceKey(key)))
+            failedFiles << key;
+    }
+
+    if (!failedFiles.isEmpty()) {
+        QString errorMsg = QString("Update the resource path[%1] error, failed files:%2.").arg(path, failedFiles.join(", "));
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::Failed, errorMsg);
         }
+        qWarning() << qPrintable(errorMsg);
     }
 }
 
@@ -489,6 +1090,8 @@ void DSGConfigServer::sync(const QString &path)
            qPrintable(configureInfo.subpath),
            qPrintable(configureInfo.resource));
     const GenericResourceKey resourceKey = getGenericResourceKey(configureInfo.resource, configureInfo.subpath);
+    // generic meta and overrides may affect all applications of the resource.
+    m_metaStore->invalidate(resourceKey);
     if (auto resource = resourceObject(resourceKey)) {
         qCInfo(cfLog, "Sync the resouce:[%s], for the appid:[%s].", qPrintable(resourceKey), qPrintable(configureInfo.appid));
         const auto &innerAppid = outerAppidToInner(configureInfo.appid);
@@ -506,22 +1109,44 @@ void DSGConfigServer::addConnWatchedService(const ConnServiceName & service)
     if (!calledFromDBus()) {
         return;
     }
+    watchService(connection(), service);
+}
+
+/*
+  \internal
+
+    \breaf Release references of the service when it's unregistered from the bus.
+*/
+QDBusServiceWatcher *DSGConfigServer::serviceWatcher(const QDBusConnection &bus)
+{
     if (!m_watcher) {
         m_watcher = new QDBusServiceWatcher(this);
-        m_watcher->setConnection(connection());
+        m_watcher->setConnection(bus);
         m_watcher->setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
         connect(m_watcher, &QDBusServiceWatcher::serviceUnregistered, [this](const QString &service){
 
             qCInfo(cfLog, "Remove watchered service:%s", qPrintable(service));
             m_watcher->removeWatchedService(service);
+            removePendingAcquires(service);
             m_refManager->releaseService(service);
         });
     }
+    return m_watcher;
+}
+
+void DSGConfigServer::watchService(const QDBusConnection &bus, const ConnServiceName &service)
+{
+    serviceWatcher(bus);
     if (!m_watcher->watchedServices().contains(service)) {
-        qCInfo(cfLog, "Add watchered service:%s, application:%s, user:%s.",
-                qPrintable(service),
-                qPrintable(getProcessNameByPid(connection().interface()->servicePid(service).value())),
-                qPrintable(getUserNameByUid(connection().interface()->serviceUid(service).value())));
+        PeerCredentials credentials;
+        if (m_credentialsCache->credentials(bus, service, credentials)) {
+            qCInfo(cfLog, "Add watchered service:%s, application:%s, user:%s.",
+                    qPrintable(service),
+                    qPrintable(credentials.processName),
+                    qPrintable(getUserNameByUid(credentials.uid)));
+        } else {
+            qCInfo(cfLog, "Add watchered service:%s.", qPrintable(service));
+        }
         m_watcher->addWatchedService(service);
     }
 }
@@ -535,27 +1160,20 @@ void DSGConfigServer::reload()
     qCInfo(cfLog()) << "Reload configuration files";
     
     const auto lastSignatures = m_fileSignatures;
-    m_fileSignatures = allConfigureFileSignatures(m_localPrefix);
+    m_fileSignatures = allConfigureFileSignatures(m_localPrefix, &m_directoryTimes);
+    m_lastFullScanTime = QDateTime::currentMSecsSinceEpoch();
 
     // Find changed files
-    auto diffConfigureFiles = [] (const QVector<FileSignature> &s1, const QVector<FileSignature> &s2) {
-        QStringList diffs;
-        for (const auto& item : std::as_const(s1)) {
-            auto iter = std::find_if(s2.cbegin(), s2.cend(), [&item](const FileSignature& other) {
-                return item.filePath == other.filePath;
-            });
-            if (iter == s2.end() || (iter->changeTime != item.changeTime || iter->size != item.size)) {
-                diffs << item.filePath;
-            }
-        }
-        return diffs;
-    };
-
     QStringList changedFiles;
-    changedFiles << diffConfigureFiles(lastSignatures, m_fileSignatures);
-    changedFiles << diffConfigureFiles(m_fileSignatures, lastSignatures);
-
-    changedFiles.removeDuplicates();
+    for (auto iter = m_fileSignatures.cbegin(); iter != m_fileSignatures.cend(); ++iter) {
+        const auto last = lastSignatures.constFind(iter.key());
+        if (last == lastSignatures.cend() || last->changeTime != iter->changeTime || last->size != iter->size)
+            changedFiles << iter.key();
+    }
+    for (auto iter = lastSignatures.cbegin(); iter != lastSignatures.cend(); ++iter) {
+        if (!m_fileSignatures.contains(iter.key()))
+            changedFiles << iter.key();
+    }
 
     // Process changed files
     for (const auto &file : std::as_const(changedFiles)) {
@@ -565,11 +1183,48 @@ void DSGConfigServer::reload()
     qCInfo(cfLog()) << "Reload completed, processed" << changedFiles.size() << "files";
 }
 
-// Get all configuration file signatures
-QVector<DSGConfigServer::FileSignature> DSGConfigServer::allConfigureFileSignatures(const QString &localPrefix)
+/*!
+ * \brief Update the configuration files reported by the watcher if their signatures are changed
+ * \a paths changed files, or removed directories whose files are all removed.
+ */
+void DSGConfigServer::onConfigureFilesChanged(const QStringList &paths)
 {
-    QVector<DSGConfigServer::FileSignature> signatures;
+    QStringList changedFiles;
+    for (const auto &path : paths) {
+        const QFileInfo info(path);
+        if (info.isFile()) {
+            const auto &signature = fileSignature(info);
+            const auto iter = m_fileSignatures.constFind(signature.filePath);
+            if (iter != m_fileSignatures.cend() && iter->changeTime == signature.changeTime && iter->size == signature.size)
+                continue;
+
+            m_fileSignatures[signature.filePath] = signature;
+            changedFiles << signature.filePath;
+            continue;
+        }
+
+        const QString directoryPrefix = path + QLatin1Char('/');
+        for (auto iter = m_fileSignatures.begin(); iter != m_fileSignatures.end();) {
+            if (iter.key() == path || iter.key().startsWith(directoryPrefix)) {
+                changedFiles << iter.key();
+                iter = m_fileSignatures.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
 
+    for (const auto &file : std::as_const(changedFiles)) {
+        update(file);
+    }
+
+    if (!changedFiles.isEmpty())
+        qCInfo(cfLog()) << "Updated changed configuration files:" << changedFiles;
+}
+
+// Get directories of configuration files, including the override directories
+QStringList DSGConfigServer::configureDirectories(const QString &localPrefix)
+{
     QStringList dirs;
     // Get generic configuration directories
     const QStringList metaDirs = DConfigMeta::genericMetaDirs(localPrefix);
@@ -584,27 +1239,412 @@ QVector<DSGConfigServer::FileSignature> DSGConfigServer::allConfigureFileSignatu
     }
     dirs << overrideDirs;
 
+    return dirs;
+}
+
+DSGConfigServer::FileSignature DSGConfigServer::fileSignature(const QFileInfo &info)
+{
+    DSGConfigServer::FileSignature signature;
+    signature.filePath = info.absoluteFilePath();
+    signature.size = info.size();
+    signature.changeTime = info.metadataChangeTime(QTimeZone::UTC);
+    return signature;
+}
+
+static qint64 directoryModifiedTime(const QString &dir)
+{
+    const QFileInfo info(dir);
+    return info.isDir() ? info.lastModified().toMSecsSinceEpoch() : -1;
+}
+
+static QString parentDirectory(const QString &path)
+{
+    return path.left(path.lastIndexOf(QLatin1Char('/')));
+}
+
+// Scan configuration files in the directory, sub directories are scanned if `recursive` or not scanned before.
+void DSGConfigServer::scanConfigureDirectory(const QString &dir, bool recursive, QHash<QString, FileSignature> &signatures,
+                                             QHash<QString, qint64> &directoryTimes)
+{
+    directoryTimes[dir] = directoryModifiedTime(dir);
+
+    const auto &entries = QDir(dir).entryInfoList(QStringList() << "*.json",
+                                                  QDir::Files | QDir::Readable | QDir::AllDirs | QDir::NoDotAndDotDot);
+    for (const auto &info : entries) {
+        if (info.isDir()) {
+            const QString path = info.absoluteFilePath();
+            if (!info.isSymLink() && (recursive || !directoryTimes.contains(path)))
+                scanConfigureDirectory(path, true, signatures, directoryTimes);
+        } else {
+            const auto &signature = fileSignature(info);
+            signatures.insert(signature.filePath, signature);
+        }
+    }
+}
+
+// Get all configuration file signatures
+QHash<QString, DSGConfigServer::FileSignature> DSGConfigServer::allConfigureFileSignatures(const QString &localPrefix,
+                                                                                          QHash<QString, qint64> *directoryTimes)
+{
+    QHash<QString, DSGConfigServer::FileSignature> signatures;
+    QHash<QString, qint64> times;
+
+    const QStringList dirs = configureDirectories(localPrefix);
     for (const QString &dir : std::as_const(dirs)) {
-        if (!QDir(dir).exists())
+        const QString root = QDir::cleanPath(dir);
+        // it's scanned as a sub directory of the other root.
+        if (times.contains(root))
+            continue;
+
+        scanConfigureDirectory(root, true, signatures, times);
+    }
+
+    if (directoryTimes)
+        *directoryTimes = times;
+    return signatures;
+}
+
+QString DSGConfigServer::accessProfilePath() const
+{
+    return QString("%1/%2/access-profile").arg(m_localPrefix).arg(configPrefixPath());
+}
+
+/*!
+ \brief 加载资源的获取记录，空闲时预加载最常用的资源
+ */
+void DSGConfigServer::startPreload()
+{
+    if (!m_accessProfile.load(accessProfilePath()))
+        return;
+
+    m_preloadQueue = m_accessProfile.hottest(m_metaStore->capacity(), QDateTime::currentSecsSinceEpoch());
+    qCInfo(cfLog()) << "Preload resources when idle, count:" << m_preloadQueue.size();
+    if (!m_preloadQueue.isEmpty())
+        m_preloadTimer->start();
+}
+
+/*
+  \internal
+
+    \breaf Load one resource in the preload queue on the loader, its file is kept in the store
+    and the next one is preloaded after it's loaded. it's discarded if it's changed while loading.
+*/
+void DSGConfigServer::preloadNext()
+{
+    while (!m_preloadQueue.isEmpty()) {
+        const auto record = m_preloadQueue.takeFirst();
+        const auto &genericResourceKey = getGenericResourceKey(record.name, record.subpath);
+        const auto &resourceKey = getResourceKey(record.appid, genericResourceKey);
+        // the acquired resource loads or has loaded the file by itself.
+        if (m_resources.contains(genericResourceKey) || m_metaStore->contains(resourceKey)
+                || m_fileLoader->isLoading(resourceKey))
+            continue;
+
+        m_preloadingKey = resourceKey;
+        m_fileLoader->load(record.appid, record.name, record.subpath, m_localPrefix);
+        return;
+    }
+    qCInfo(cfLog()) << "Preload resources completed, stored count:" << m_metaStore->size();
+}
+
+QString DSGConfigServer::handoffPath() const
+{
+    return QString("%1/%2/handoff").arg(m_localPrefix).arg(configPrefixPath());
+}
+
+// Digest of the configuration file signatures, the handoff is discarded if it's changed.
+QByteArray DSGConfigServer::signatureDigest() const
+{
+    auto paths = m_fileSignatures.keys();
+    std::sort(paths.begin(), paths.end());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const auto &path : std::as_const(paths)) {
+        const auto &signature = m_fileSignatures[path];
+        hash.addData(path.toUtf8());
+        hash.addData(QByteArray::number(signature.size));
+        hash.addData(QByteArray::number(signature.changeTime.toMSecsSinceEpoch()));
+    }
+    return hash.result();
+}
+
+/*!
+ \brief 退出时保存客户端对连接的引用，重启后恢复连接对象，客户端无需重新获取
+ */
+void DSGConfigServer::saveHandoff() const
+{
+    const auto &path = handoffPath();
+    QList<ConnReference> references;
+    for (const auto &reference : m_refManager->references()) {
+        // the direct channel is disconnected when the daemon exits.
+        if (PeerCredentialsCache::isPeerService(reference.service))
             continue;
+        const auto resource = m_resources.value(getGenericResourceKey(reference.key));
+        if (resource && resource->getConn(reference.key))
+            references << reference;
+    }
+    // the ones not restored yet are handed over again.
+    for (const auto &items : m_handoffReferences)
+        references << items;
+    if (references.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(cfLog()) << "Failed to save the handoff:" << file.errorString();
+        return;
+    }
 
-        QDirIterator iterator(dir, QStringList() << "*.json",
-                             QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
-        while (iterator.hasNext()) {
-            iterator.next();
-            const QString filePath = iterator.fileInfo().absoluteFilePath();
-            
-            QFileInfo fileInfo(filePath);
-            if (fileInfo.exists()) {
-                DSGConfigServer::FileSignature signature;
-                signature.filePath = filePath;
-                signature.size = fileInfo.size();
-                signature.changeTime = fileInfo.metadataChangeTime(QTimeZone::UTC);
-
-                signatures << signature;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << HandoffMagic << HandoffVersion << signatureDigest() << static_cast<quint32>(references.size());
+    for (const auto &reference : std::as_const(references))
+        stream << reference.service << reference.key << static_cast<qint32>(reference.count);
+
+    if (!file.commit()) {
+        qCWarning(cfLog()) << "Failed to save the handoff:" << file.errorString();
+        return;
+    }
+    qCInfo(cfLog()) << "Saved the handoff, references count:" << references.size();
+}
+
+// name and subpath of the generic resource key "/name/subpath".
+static void splitGenericResourceKey(const GenericResourceKey &key, QString &name, QString &subpath)
+{
+    const int nameEnd = key.indexOf('/', 1);
+    name = key.mid(1, nameEnd < 0 ? -1 : nameEnd - 1);
+    subpath = nameEnd < 0 ? QString() : key.mid(nameEnd);
+}
+
+/*!
+ \brief 恢复上次退出时仍被客户端引用的连接，配置文件变化或客户端已退出时不恢复
+ */
+void DSGConfigServer::restoreHandoff()
+{
+    QFile file(handoffPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0, count = 0;
+    QByteArray digest;
+    stream >> magic >> version >> digest >> count;
+    QList<ConnReference> references;
+    for (quint32 i = 0; i < count && magic == HandoffMagic && stream.status() == QDataStream::Ok; i++) {
+        ConnReference reference;
+        qint32 refCount = 0;
+        stream >> reference.service >> reference.key >> refCount;
+        reference.count = refCount;
+        references << reference;
+    }
+    const bool valid = stream.status() == QDataStream::Ok && magic == HandoffMagic && version == HandoffVersion;
+    // it's used once.
+    file.remove();
+    if (!valid) {
+        qCWarning(cfLog()) << "Ignore the broken handoff:" << file.fileName();
+        return;
+    }
+    if (digest != signatureDigest()) {
+        qCInfo(cfLog()) << "Configuration files are changed, ignore the handoff.";
+        return;
+    }
+
+    // services are watched without asking the bus, the exited ones are released by one listing.
+    auto bus = QDBusConnection::systemBus();
+    auto watcher = serviceWatcher(bus);
+    QSet<ConnServiceName> services;
+    QSet<ResourceKey> keys;
+    for (const auto &reference : std::as_const(references)) {
+        if (!watcher->watchedServices().contains(reference.service))
+            watcher->addWatchedService(reference.service);
+        services.insert(reference.service);
+
+        const auto &resourceKey = getResourceKey(reference.key);
+        m_handoffReferences[resourceKey] << reference;
+        keys.insert(resourceKey);
+    }
+    if (qgetenv("DSG_CONFIG_CONNECTION_DISABLE_DBUS").isEmpty() && bus.interface()) {
+        auto call = new QDBusPendingCallWatcher(bus.interface()->asyncCall(QStringLiteral("ListNames")), this);
+        connect(call, &QDBusPendingCallWatcher::finished, this, [this, services](QDBusPendingCallWatcher *call) {
+            call->deleteLater();
+            const QDBusPendingReply<QStringList> reply = *call;
+            if (reply.isError()) {
+                qCWarning(cfLog()) << "Failed to list the services of the handoff:" << reply.error().message();
+                return;
             }
+            releaseHandoffServices(services, reply.value());
+        });
+    }
+
+    // connections are registered when their configuration files are loaded on the loader.
+    for (const auto &resourceKey : std::as_const(keys)) {
+        const auto &genericResourceKey = getGenericResourceKeyByResourceKey(resourceKey);
+        const auto resource = resourceObject(genericResourceKey);
+        if ((resource && resource->getFile(resourceKey)) || m_metaStore->contains(resourceKey)) {
+            restoreReferences(resourceKey);
+            continue;
         }
+        QString name, subpath;
+        splitGenericResourceKey(genericResourceKey, name, subpath);
+        m_fileLoader->load(getAppidByResourceKey(resourceKey), name, subpath, m_localPrefix);
     }
+    qCInfo(cfLog()) << "Restore the handoff when loaded, references count:" << references.size();
+}
 
-    return signatures;
+/*
+  \internal
+
+    \breaf Register the handed over connections of the resource, its configuration file is loaded
+    or stored. it's loaded synchronously if it's changed while loading, the same as acquiring.
+*/
+void DSGConfigServer::restoreReferences(const ResourceKey &key)
+{
+    const auto references = m_handoffReferences.take(key);
+    for (const auto &reference : references) {
+        QString name, subpath;
+        splitGenericResourceKey(getGenericResourceKey(reference.key), name, subpath);
+        const QString appid = innerAppidToOuter(getAppidByResourceKey(key));
+        QString errorMsg;
+        auto conn = getOrCreateConn(getConnectionKey(reference.key), appid, name, subpath, errorMsg);
+        if (!conn) {
+            qCWarning(cfLog()) << "Failed to restore the connection:" << reference.key << errorMsg;
+            continue;
+        }
+        for (int i = 0; i < reference.count; i++)
+            m_refManager->refResource(reference.service, conn->key());
+    }
+    if (!references.isEmpty())
+        qCDebug(cfLog()) << "Restored the handoff of the resource:" << key << "references count:" << references.size();
+}
+
+/*
+  \internal
+
+    \breaf Release the handed over references of the services exited before they were watched,
+    whether their connections are restored or still waiting for the configuration files.
+    unique names aren't reused, services registered after listing aren't handed over.
+*/
+void DSGConfigServer::releaseHandoffServices(const QSet<ConnServiceName> &services, const QStringList &registeredServices)
+{
+    for (const auto &service : services) {
+        if (registeredServices.contains(service) || !m_watcher->watchedServices().contains(service))
+            continue;
+
+        qCInfo(cfLog, "Release the handoff of the exited service:%s", qPrintable(service));
+        m_watcher->removeWatchedService(service);
+        removePendingAcquires(service);
+        m_refManager->releaseService(service);
+    }
+}
+
+QString DSGConfigServer::signatureSnapshotPath() const
+{
+    return QString("%1/%2/signatures").arg(m_localPrefix).arg(configPrefixPath());
+}
+
+/*!
+ \brief 加载上次服务退出时保存的配置文件签名，只重新扫描修改时间变化的目录
+ \return 是否加载成功，失败时需要扫描所有配置文件
+ */
+bool DSGConfigServer::loadSignatureSnapshot()
+{
+    QFile file(signatureSnapshotPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != SignatureSnapshotMagic || version != SignatureSnapshotVersion) {
+        qCWarning(cfLog()) << "Ignore the signature snapshot of unknown version:" << file.fileName();
+        return false;
+    }
+
+    qint64 lastFullScanTime = 0;
+    QStringList roots;
+    QHash<QString, qint64> times;
+    quint32 count = 0;
+    stream >> lastFullScanTime >> roots >> times >> count;
+    QHash<QString, FileSignature> signatures;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        FileSignature signature;
+        stream >> signature.filePath >> signature.size >> signature.changeTime;
+        signatures.insert(signature.filePath, signature);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCWarning(cfLog()) << "Ignore the broken signature snapshot:" << file.fileName();
+        return false;
+    }
+
+    QStringList currentRoots;
+    for (const auto &dir : configureDirectories(m_localPrefix))
+        currentRoots << QDir::cleanPath(dir);
+    if (roots != currentRoots) {
+        qCInfo(cfLog()) << "Configuration directories are changed, ignore the signature snapshot.";
+        return false;
+    }
+
+    // Entries of the directory are added, removed or renamed if its modified time is changed.
+    QStringList changedDirs;
+    for (auto iter = times.cbegin(); iter != times.cend(); ++iter) {
+        if (directoryModifiedTime(iter.key()) != iter.value())
+            changedDirs << iter.key();
+    }
+    for (const auto &dir : std::as_const(changedDirs)) {
+        for (auto iter = signatures.begin(); iter != signatures.end();) {
+            if (parentDirectory(iter.key()) == dir) {
+                iter = signatures.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        if (directoryModifiedTime(dir) < 0 && !roots.contains(dir)) {
+            // files of the sub directories are removed when the sub directories are checked.
+            times.remove(dir);
+            continue;
+        }
+        scanConfigureDirectory(dir, false, signatures, times);
+    }
+
+    m_fileSignatures = signatures;
+    m_directoryTimes = times;
+    m_lastFullScanTime = lastFullScanTime;
+    qCInfo(cfLog()) << "Loaded the signature snapshot, rescanned directories:" << changedDirs.size();
+    return true;
+}
+
+/*!
+ \brief 保存配置文件签名，供下次启动时加载
+ */
+void DSGConfigServer::saveSignatureSnapshot() const
+{
+    const auto &path = signatureSnapshotPath();
+    if (!QDir().mkpath(QFileInfo(path).path()))
+        return;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(cfLog()) << "Failed to save the signature snapshot:" << file.errorString();
+        return;
+    }
+
+    QStringList roots;
+    for (const auto &dir : configureDirectories(m_localPrefix))
+        roots << QDir::cleanPath(dir);
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << SignatureSnapshotMagic << SignatureSnapshotVersion << m_lastFullScanTime;
+    stream << roots << m_directoryTimes << static_cast<quint32>(m_fileSignatures.size());
+    for (const auto &signature : m_fileSignatures)
+        stream << signature.filePath << signature.size << signature.changeTime;
+
+    if (!file.commit())
+        qCWarning(cfLog()) << "Failed to save the signature snapshot:" << file.errorString();
 }
@@ -5,15 +5,38 @@
 #pragma once
 
 #include "dconfig_global.h"
+#include "dconfigaccessprofile.h"
+#include "dconfigrefmanager.h"
+#include <dtkcore_global.h>
 #include <QObject>
 #include <QDBusObjectPath>
 #include <QDBusContext>
 #include <QDBusServiceWatcher>
+#include <QDBusMessage>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSet>
+
+DCORE_BEGIN_NAMESPACE
+class DConfigFile;
+DCORE_END_NAMESPACE
 
 class DSGConfigResource;
+class DSGConfigConn;
 class RefManager;
 class ConfigSyncBatchRequest;
 class ConfigSyncRequestCache;
+class PeerCredentialsCache;
+class ConfigPersistenceWriter;
+class ConfigJournal;
+class ConfigFileWatcher;
+class ConfigMetaStore;
+class ConfigDirectChannels;
+class ConfigFileLoader;
+class ConfigDependencyGraph;
+class ConfigStatistics;
+class QFileInfo;
+class QTimer;
 /**
  * @brief The DSGConfigServer class
  * 管理配置策略服务
@@ -41,6 +64,9 @@ public:
 
     int resourceSize() const;
 
+    DSGConfigConn *acquireConnection(const ConnServiceName &service, const uint uid, const QString &appid,
+                                     const QString &name, const QString &subpath, QString &errorMsg);
+
 Q_SIGNALS:
     void releaseResource(const ConnKey& resource);
 
@@ -51,6 +77,8 @@ public Q_SLOTS:
 
     QDBusObjectPath acquireManagerV2(const uint &uid, const QString &appid, const QString &name, const QString &subpath);
 
+    QString openDirectChannel();
+
     void update(const QString &path);
 
     void sync(const QString &path);
@@ -58,6 +86,14 @@ public Q_SLOTS:
     void setDelayReleaseTime(const int ms);
     int delayReleaseTime() const;
 
+    void setSyncDelayTime(const int ms);
+    int syncDelayTime() const;
+    void setSyncMaxStaleness(const int ms);
+    int syncMaxStaleness() const;
+    void setSyncBatchCount(const int count);
+    int syncBatchCount() const;
+    int syncQueueDepth() const;
+
     void enableVerboseLogging();
     void disableVerboseLogging();
     void setLogRules(const QString &rules);
@@ -66,19 +102,45 @@ public Q_SLOTS:
 
     void reload();
 
+    QVariantMap statistics();
+    QVariantMap latencyHistogram(const QString &name);
+    void resetStatistics();
+
 private Q_SLOTS:
     void onReleaseChanged(const ConnServiceName &service, const ConnKey &connKey);
 
     void addConnWatchedService(const ConnServiceName &service);
 
+    void onDirectChannelClosed(const ConnServiceName &service);
+
+    void onConfigFileLoaded(const ResourceKey &key, DTK_CORE_NAMESPACE::DConfigFile *file);
+
     void onReleaseResource(const ConnKey &connKey);
 
     void onTryExit();
 
     void doSyncConfigCache(const ConfigSyncBatchRequest &request);
 
+    void onConfigureFilesChanged(const QStringList &paths);
+
+    void preloadNext();
+
 private:
     ResourceKey getResourceKeyByConfigCache(const ConfigCacheKey &key);
+    DSGConfigConn *getOrCreateConn(const uint uid, const QString &appid, const QString &name, const QString &subpath, QString &errorMsg);
+    QDBusServiceWatcher *serviceWatcher(const QDBusConnection &bus);
+    void watchService(const QDBusConnection &bus, const ConnServiceName &service);
+    bool deferAcquire(const ConnServiceName &service, const uint uid, const QString &appid, const QString &name, const QString &subpath);
+    void removePendingAcquires(const ConnServiceName &service);
+
+    QList<ConnKey> connectionsByUid(const uint uid);
+    QString journalDirectory() const;
+    void replayJournal();
+    void checkpointJournal();
+    void confirmJournalCheckpoint(qint64 checkpoint);
+    void markFailedObjectsUnsaved();
+    void removeJournalSegments(const QStringList &segments);
+    void removeUserConnection(const ConnKey &connKey);
 
     ConfigureId getConfigureIdByPath(const QString &path);
 
@@ -89,12 +151,30 @@ private:
         QDateTime changeTime;
         QString filePath;
     };
-    static QVector<FileSignature> allConfigureFileSignatures(const QString &localPrefix);
+    static QStringList configureDirectories(const QString &localPrefix);
+    static FileSignature fileSignature(const QFileInfo &info);
+    static void scanConfigureDirectory(const QString &dir, bool recursive, QHash<QString, FileSignature> &signatures,
+                                       QHash<QString, qint64> &directoryTimes);
+    static QHash<QString, FileSignature> allConfigureFileSignatures(const QString &localPrefix,
+                                                                    QHash<QString, qint64> *directoryTimes = nullptr);
+    QString signatureSnapshotPath() const;
+    bool loadSignatureSnapshot();
+    void saveSignatureSnapshot() const;
+    QString accessProfilePath() const;
+    QByteArray signatureDigest() const;
+    QString handoffPath() const;
+    void saveHandoff() const;
+    void restoreHandoff();
+    void restoreReferences(const ResourceKey &key);
+    void releaseHandoffServices(const QSet<ConnServiceName> &services, const QStringList &registeredServices);
+    void startPreload();
 
 private:
 
     // 所有链接，一个资源对应一个链接
     QMap<GenericResourceKey, DSGConfigResource *> m_resources;
+    // uid -> resources having the user's connection, entries of removed resource are dropped lazily.
+    QHash<uint, QSet<GenericResourceKey>> m_uidResources;
 
     QDBusServiceWatcher *m_watcher = nullptr;
 
@@ -103,7 +183,46 @@ private:
     QString m_localPrefix;
     bool m_enableExit = false;
     ConfigSyncRequestCache *m_syncRequestCache = nullptr;
-
-    // Last time of the configuration file signature
-    QVector<FileSignature> m_fileSignatures;
+    PeerCredentialsCache *m_credentialsCache = nullptr;
+    ConfigPersistenceWriter *m_writer = nullptr;
+    ConfigJournal *m_journal = nullptr;
+    // replaying failed, segments are kept for the next startup.
+    bool m_keepJournal = false;
+    ConfigFileWatcher *m_fileWatcher = nullptr;
+    ConfigMetaStore *m_metaStore = nullptr;
+    ConfigDirectChannels *m_directChannels = nullptr;
+    ConfigFileLoader *m_fileLoader = nullptr;
+    ConfigDependencyGraph *m_dependencies = nullptr;
+    // it's destroyed after the writer which records into it.
+    ConfigStatistics *m_statistics = nullptr;
+
+    // acquire request waiting for the configuration file loaded on the worker, its reply is delayed.
+    struct PendingAcquire {
+        QDBusMessage message;
+        QString connectionName;
+        ConnServiceName service;
+        uint uid;
+        QString appid;
+        QString name;
+        QString subpath;
+        QElapsedTimer timer;
+    };
+    QHash<ResourceKey, QList<PendingAcquire>> m_pendingAcquires;
+    // references handed over by the last daemon, restored when the configuration file is loaded.
+    QHash<ResourceKey, QList<ConnReference>> m_handoffReferences;
+
+    ConfigAccessProfile m_accessProfile;
+    // resources preloaded into `m_metaStore` when idle, the hottest is the first.
+    QList<ConfigAccessRecord> m_preloadQueue;
+    // the resource being preloaded, the next is preloaded after it's loaded.
+    ResourceKey m_preloadingKey;
+    QTimer *m_preloadTimer = nullptr;
+
+    // Last time of the configuration file signature, file path -> signature
+    QHash<QString, FileSignature> m_fileSignatures;
+    // Modified time of the directories when their files are scanned, it's -1 if not existing.
+    QHash<QString, qint64> m_directoryTimes;
+    // msecs since epoch of the last scan of all configuration files, it's kept in the signature snapshot.
+    qint64 m_lastFullScanTime = 0;
+    bool m_initialized = false;
 };
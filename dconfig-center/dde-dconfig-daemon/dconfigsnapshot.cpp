@@ -0,0 +1,229 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigsnapshot.h"
+#include "dconfig_global.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QThread>
+
+#include <atomic>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static constexpr quint32 SnapshotMagic = 0x44534756; // "DSGV"
+static constexpr quint32 SnapshotVersion = 1;
+static constexpr quint32 SnapshotStale = 0x1;
+static constexpr int SnapshotReadRetries = 100;
+
+/*
+    Layout of the shared memory, `sequence` is odd while the daemon is writing,
+    readers copy the payload and retry if `sequence` is changed.
+*/
+struct ConfigValueSnapshotHeader
+{
+    quint32 magic;
+    quint32 version;
+    std::atomic<quint32> sequence;
+    std::atomic<quint32> flags;
+    quint32 capacity;
+    quint32 size;
+};
+static_assert(sizeof(std::atomic<quint32>) == sizeof(quint32), "The header is shared by processes.");
+static constexpr int HeaderSize = 64;
+static_assert(sizeof(ConfigValueSnapshotHeader) <= HeaderSize, "The header is too large.");
+
+static ConfigValueSnapshotHeader *header(uchar *data)
+{
+    return reinterpret_cast<ConfigValueSnapshotHeader *>(data);
+}
+
+ConfigValueSnapshot::ConfigValueSnapshot()
+{
+}
+
+ConfigValueSnapshot::~ConfigValueSnapshot()
+{
+    // clients still having the memory know it's not updated anymore.
+    invalidate();
+    if (m_data)
+        munmap(m_data, static_cast<size_t>(m_capacity));
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+/*!
+ \brief 创建共享内存
+ \a capacity 共享内存大小，包含头部
+ \return 是否创建成功
+ */
+bool ConfigValueSnapshot::create(const int capacity)
+{
+    if (m_fd >= 0 || capacity <= HeaderSize)
+        return false;
+
+    m_fd = memfd_create("dconfig-values", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (m_fd < 0) {
+        qCWarning(cfLog) << "Failed to create memfd for the value snapshot:" << strerror(errno);
+        return false;
+    }
+    if (ftruncate(m_fd, capacity) != 0) {
+        qCWarning(cfLog) << "Failed to resize the value snapshot:" << strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    void *data = mmap(nullptr, static_cast<size_t>(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) {
+        qCWarning(cfLog) << "Failed to map the value snapshot:" << strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    m_data = static_cast<uchar *>(data);
+    m_capacity = capacity;
+
+    auto head = new (m_data) ConfigValueSnapshotHeader;
+    head->magic = SnapshotMagic;
+    head->version = SnapshotVersion;
+    head->sequence.store(0, std::memory_order_relaxed);
+    head->flags.store(0, std::memory_order_relaxed);
+    head->capacity = static_cast<quint32>(capacity);
+    head->size = 0;
+
+    // clients can't resize it, and can't map it writable if the kernel supports.
+    int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+    seals |= F_SEAL_FUTURE_WRITE;
+#endif
+    if (fcntl(m_fd, F_ADD_SEALS, seals) != 0)
+        qCWarning(cfLog) << "Failed to seal the value snapshot:" << strerror(errno);
+
+    return true;
+}
+
+bool ConfigValueSnapshot::isValid() const
+{
+    return m_data && !(header(m_data)->flags.load(std::memory_order_relaxed) & SnapshotStale);
+}
+
+int ConfigValueSnapshot::fd() const
+{
+    return m_fd;
+}
+
+int ConfigValueSnapshot::capacity() const
+{
+    return m_capacity;
+}
+
+quint32 ConfigValueSnapshot::sequence() const
+{
+    return m_data ? header(m_data)->sequence.load(std::memory_order_acquire) : 0;
+}
+
+/*!
+ \brief 发布新的值
+ \a values 配置项名称及值
+ \return 超出容量时返回false，快照失效
+ */
+bool ConfigValueSnapshot::publish(const QVariantMap &values)
+{
+    if (!isValid())
+        return false;
+
+    const auto &payload = serialize(values);
+    if (payload.size() > m_capacity - HeaderSize) {
+        qCDebug(cfLog) << "Value snapshot is full, size:" << payload.size() << ", capacity:" << m_capacity;
+        invalidate();
+        return false;
+    }
+
+    auto head = header(m_data);
+    const auto sequence = head->sequence.load(std::memory_order_relaxed);
+    head->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    head->size = static_cast<quint32>(payload.size());
+    memcpy(m_data + HeaderSize, payload.constData(), static_cast<size_t>(payload.size()));
+    head->sequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+/*!
+ \brief 使快照失效，客户端需要通过D-Bus重新获取
+ */
+void ConfigValueSnapshot::invalidate()
+{
+    if (m_data)
+        header(m_data)->flags.fetch_or(SnapshotStale, std::memory_order_release);
+}
+
+/*!
+ \brief 容纳这些值及后续修改需要的共享内存大小，按页对齐
+ */
+int ConfigValueSnapshot::requiredCapacity(const QVariantMap &values)
+{
+    const int pageSize = static_cast<int>(sysconf(_SC_PAGESIZE));
+    const int required = HeaderSize + serialize(values).size() * 2;
+    return (required + pageSize - 1) / pageSize * pageSize;
+}
+
+/*!
+ \brief 从映射的共享内存中读取值，供客户端使用
+ \a data 映射的共享内存
+ \a size 映射的大小
+ \a values 读取到的值
+ \return 快照已失效或格式错误时返回false
+ */
+bool ConfigValueSnapshot::read(const uchar *data, const size_t size, QVariantMap &values)
+{
+    if (!data || size < static_cast<size_t>(HeaderSize))
+        return false;
+
+    auto head = reinterpret_cast<const ConfigValueSnapshotHeader *>(data);
+    if (head->magic != SnapshotMagic || head->version != SnapshotVersion)
+        return false;
+
+    for (int i = 0; i < SnapshotReadRetries; i++) {
+        const auto sequence = head->sequence.load(std::memory_order_acquire);
+        if (sequence & 1) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+        if (head->flags.load(std::memory_order_acquire) & SnapshotStale)
+            return false;
+
+        const auto payloadSize = head->size;
+        if (payloadSize > size - HeaderSize)
+            return false;
+        const QByteArray payload(reinterpret_cast<const char *>(data) + HeaderSize, static_cast<int>(payloadSize));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (head->sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_5_11);
+        QVariantMap result;
+        stream >> result;
+        if (stream.status() != QDataStream::Ok)
+            return false;
+        values = result;
+        return true;
+    }
+    return false;
+}
+
+QByteArray ConfigValueSnapshot::serialize(const QVariantMap &values)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_11);
+    stream << values;
+    return payload;
+}
@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QVariantMap>
+#include <QByteArray>
+
+/**
+ * @brief The ConfigValueSnapshot class
+ * 在共享内存（memfd）中发布连接的配置项的值，客户端映射只读内存后通过序列号无锁读取。
+ * 共享内存大小固定，值超出容量时此快照失效，客户端需要重新获取新的快照。
+ */
+class ConfigValueSnapshot
+{
+public:
+    ConfigValueSnapshot();
+    ~ConfigValueSnapshot();
+
+    bool create(const int capacity);
+    bool isValid() const;
+    int fd() const;
+    int capacity() const;
+    quint32 sequence() const;
+
+    bool publish(const QVariantMap &values);
+    void invalidate();
+
+    static int requiredCapacity(const QVariantMap &values);
+    static bool read(const uchar *data, const size_t size, QVariantMap &values);
+
+private:
+    Q_DISABLE_COPY(ConfigValueSnapshot)
+
+    static QByteArray serialize(const QVariantMap &values);
+
+    int m_fd = -1;
+    int m_capacity = 0;
+    uchar *m_data = nullptr;
+};
@@ -0,0 +1,234 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigstats.h"
+
+#include <QVariantList>
+
+#include <cmath>
+
+static const char *const MetricNames[] = {
+    "acquireManagerV2",
+    "value",
+    "setValue",
+    "reset",
+    "release",
+    "update",
+    "reparse",
+    "syncWrite",
+};
+static_assert(sizeof(MetricNames) / sizeof(MetricNames[0]) == ConfigStatistics::MetricCount, "missing metric name");
+
+ConfigLatencyHistogram::ConfigLatencyHistogram()
+{
+    reset();
+}
+
+void ConfigLatencyHistogram::record(const qint64 usec)
+{
+    const qint64 value = qMax<qint64>(usec, 0);
+    m_counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(static_cast<quint64>(value), std::memory_order_relaxed);
+
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void ConfigLatencyHistogram::reset()
+{
+    for (auto &item : m_counts)
+        item.store(0, std::memory_order_relaxed);
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+quint64 ConfigLatencyHistogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+quint64 ConfigLatencyHistogram::sum() const
+{
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+qint64 ConfigLatencyHistogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+/*!
+ \brief 获取百分位耗时
+ \a percent 百分位，如99表示p99
+ \return 所在区间的上界，单位为微秒，不超过记录的最大值
+ */
+qint64 ConfigLatencyHistogram::percentile(const double percent) const
+{
+    quint64 total = 0;
+    for (const auto &item : m_counts)
+        total += item.load(std::memory_order_relaxed);
+    if (total == 0)
+        return 0;
+
+    const auto rank = qMax<quint64>(1, static_cast<quint64>(std::ceil(total * qBound(0.0, percent, 100.0) / 100.0)));
+    quint64 accumulated = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        accumulated += m_counts[i].load(std::memory_order_relaxed);
+        if (accumulated >= rank)
+            return qMin(bucketUpperBound(i), max());
+    }
+    return max();
+}
+
+QVariantMap ConfigLatencyHistogram::toMap() const
+{
+    const auto total = count();
+    QVariantMap result;
+    result["count"] = total;
+    result["sum"] = sum();
+    result["max"] = max();
+    result["mean"] = total > 0 ? static_cast<qint64>(sum() / total) : 0;
+    result["p50"] = percentile(50);
+    result["p90"] = percentile(90);
+    result["p99"] = percentile(99);
+    result["p999"] = percentile(99.9);
+    return result;
+}
+
+/*!
+ \brief 获取非空区间的上界及计数
+ */
+QVariantMap ConfigLatencyHistogram::buckets() const
+{
+    QVariantList bounds;
+    QVariantList counts;
+    for (int i = 0; i < BucketCount; ++i) {
+        const auto value = m_counts[i].load(std::memory_order_relaxed);
+        if (value == 0)
+            continue;
+        bounds << bucketUpperBound(i);
+        counts << value;
+    }
+    QVariantMap result;
+    result["upperBounds"] = bounds;
+    result["counts"] = counts;
+    return result;
+}
+
+int ConfigLatencyHistogram::bucketIndex(const qint64 usec)
+{
+    const auto value = static_cast<quint64>(qMax<qint64>(usec, 0));
+    if (value < SubBucketCount)
+        return static_cast<int>(value);
+
+    const int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > MaxMagnitude)
+        return BucketCount - 1;
+
+    const int shift = magnitude - SubBucketBits;
+    const int subBucket = static_cast<int>(value >> shift) - SubBucketCount;
+    return SubBucketCount + shift * SubBucketCount + subBucket;
+}
+
+qint64 ConfigLatencyHistogram::bucketUpperBound(const int index)
+{
+    if (index < SubBucketCount)
+        return index;
+
+    const int shift = (index - SubBucketCount) / SubBucketCount;
+    const int subBucket = (index - SubBucketCount) % SubBucketCount;
+    const qint64 lower = static_cast<qint64>(SubBucketCount + subBucket) << shift;
+    return lower + (static_cast<qint64>(1) << shift) - 1;
+}
+
+ConfigStatistics::ConfigStatistics(QObject *parent)
+    : QObject(parent)
+    , m_bytesWritten(0)
+{
+    m_resetTime.start();
+}
+
+void ConfigStatistics::record(const Metric metric, const qint64 usec)
+{
+    if (metric < 0 || metric >= MetricCount)
+        return;
+
+    m_histograms[metric].record(usec);
+}
+
+void ConfigStatistics::addBytesWritten(const quint64 bytes)
+{
+    m_bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+quint64 ConfigStatistics::bytesWritten() const
+{
+    return m_bytesWritten.load(std::memory_order_relaxed);
+}
+
+const ConfigLatencyHistogram &ConfigStatistics::histogram(const Metric metric) const
+{
+    return m_histograms[qBound<int>(0, metric, MetricCount - 1)];
+}
+
+/*!
+ \brief 获取所有统计项的调用次数及耗时（单位为微秒）
+ */
+QVariantMap ConfigStatistics::toMap() const
+{
+    QVariantMap result;
+    for (int i = 0; i < MetricCount; ++i)
+        result[metricName(static_cast<Metric>(i))] = m_histograms[i].toMap();
+    result["bytesWritten"] = bytesWritten();
+    // the statistics are recorded since the time.
+    result["elapsed"] = m_resetTime.elapsed();
+    return result;
+}
+
+void ConfigStatistics::reset()
+{
+    for (auto &item : m_histograms)
+        item.reset();
+    m_bytesWritten.store(0, std::memory_order_relaxed);
+    m_resetTime.restart();
+}
+
+QString ConfigStatistics::metricName(const Metric metric)
+{
+    if (metric < 0 || metric >= MetricCount)
+        return QString();
+
+    return QString::fromLatin1(MetricNames[metric]);
+}
+
+ConfigStatistics::Metric ConfigStatistics::metric(const QString &name)
+{
+    for (int i = 0; i < MetricCount; ++i) {
+        if (name == QLatin1String(MetricNames[i]))
+            return static_cast<Metric>(i);
+    }
+    return MetricCount;
+}
+
+ConfigLatencyTimer::ConfigLatencyTimer(ConfigStatistics *statistics, const ConfigStatistics::Metric metric)
+    : m_statistics(statistics)
+    , m_metric(metric)
+{
+    if (m_statistics)
+        m_timer.start();
+}
+
+ConfigLatencyTimer::~ConfigLatencyTimer()
+{
+    if (m_statistics && m_timer.isValid())
+        m_statistics->record(m_metric, m_timer.nsecsElapsed() / 1000);
+}
+
+void ConfigLatencyTimer::cancel()
+{
+    m_timer.invalidate();
+}
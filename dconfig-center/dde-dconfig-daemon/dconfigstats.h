@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QVariantMap>
+#include <array>
+#include <atomic>
+
+/**
+ * @brief The ConfigLatencyHistogram class
+ * 记录耗时的分布，每个2的幂区间分为8个线性子区间，相对误差不超过12.5%，
+ * 可在多个线程中无锁记录。
+ */
+class ConfigLatencyHistogram
+{
+public:
+    ConfigLatencyHistogram();
+
+    void record(const qint64 usec);
+    void reset();
+
+    quint64 count() const;
+    quint64 sum() const;
+    qint64 max() const;
+    qint64 percentile(const double percent) const;
+    QVariantMap toMap() const;
+    QVariantMap buckets() const;
+
+    static int bucketIndex(const qint64 usec);
+    static qint64 bucketUpperBound(const int index);
+
+private:
+    static constexpr int SubBucketBits = 3;
+    static constexpr int SubBucketCount = 1 << SubBucketBits;
+    // values up to 2^40 microseconds, larger ones are counted in the last bucket.
+    static constexpr int MaxMagnitude = 40;
+    static constexpr int BucketCount = SubBucketCount + (MaxMagnitude - SubBucketBits + 1) * SubBucketCount;
+
+    std::array<std::atomic<quint64>, BucketCount> m_counts;
+    std::atomic<quint64> m_count;
+    std::atomic<quint64> m_sum;
+    std::atomic<qint64> m_max;
+};
+
+/**
+ * @brief The ConfigStatistics class
+ * 服务的运行统计，包括主要方法的调用次数及耗时、保存配置的耗时及写入字节数、重新解析的耗时
+ */
+class ConfigStatistics : public QObject
+{
+    Q_OBJECT
+public:
+    enum Metric {
+        AcquireManager,
+        Value,
+        SetValue,
+        Reset,
+        Release,
+        Update,
+        Reparse,
+        SyncWrite,
+        MetricCount
+    };
+
+    explicit ConfigStatistics(QObject *parent = nullptr);
+
+    void record(const Metric metric, const qint64 usec);
+    void addBytesWritten(const quint64 bytes);
+    quint64 bytesWritten() const;
+    const ConfigLatencyHistogram &histogram(const Metric metric) const;
+    QVariantMap toMap() const;
+    void reset();
+
+    static QString metricName(const Metric metric);
+    static Metric metric(const QString &name);
+
+private:
+    std::array<ConfigLatencyHistogram, MetricCount> m_histograms;
+    std::atomic<quint64> m_bytesWritten;
+    QElapsedTimer m_resetTime;
+};
+
+/**
+ * @brief The ConfigLatencyTimer class
+ * 在作用域结束时记录耗时，统计对象为空时不记录
+ */
+class ConfigLatencyTimer
+{
+public:
+    ConfigLatencyTimer(ConfigStatistics *statistics, const ConfigStatistics::Metric metric);
+    ~ConfigLatencyTimer();
+
+    void cancel();
+
+private:
+    ConfigStatistics *m_statistics;
+    ConfigStatistics::Metric m_metric;
+    QElapsedTimer m_timer;
+};
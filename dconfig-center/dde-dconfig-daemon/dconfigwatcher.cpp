@@ -0,0 +1,257 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigwatcher.h"
+#include "dconfig_global.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif // Q_OS_LINUX
+
+static constexpr int DefaultDelayTime = 200;
+
+static bool isConfigureFile(const QString &name)
+{
+    return name.endsWith(QLatin1String(".json"));
+}
+
+ConfigFileWatcher::ConfigFileWatcher(QObject *parent)
+    : QObject(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(DefaultDelayTime);
+    connect(&m_flushTimer, &QTimer::timeout, this, &ConfigFileWatcher::flushChangedFiles);
+}
+
+ConfigFileWatcher::~ConfigFileWatcher()
+{
+    stop();
+}
+
+/*!
+ \brief 开始监控指定目录及其子目录
+ \a directories 需要监控的目录，不存在的目录在创建后加入监控
+ \return 是否开始监控
+ */
+bool ConfigFileWatcher::start(const QStringList &directories)
+{
+    stop();
+#ifdef Q_OS_LINUX
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        qCWarning(cfLog) << "Failed to initialize inotify, error:" << strerror(errno);
+        return false;
+    }
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &ConfigFileWatcher::onActivated);
+
+    for (const auto &directory : directories)
+        m_roots << QDir::cleanPath(directory);
+
+    watchRoots(false);
+    qCInfo(cfLog) << "Start watching configuration directories, watch count:" << m_watches.size();
+    return true;
+#else
+    Q_UNUSED(directories)
+    return false;
+#endif // Q_OS_LINUX
+}
+
+void ConfigFileWatcher::stop()
+{
+    m_flushTimer.stop();
+    m_changedFiles.clear();
+    m_watches.clear();
+    m_directories.clear();
+    m_ancestorWatches.clear();
+    m_roots.clear();
+
+    delete m_notifier;
+    m_notifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif // Q_OS_LINUX
+}
+
+bool ConfigFileWatcher::isActive() const
+{
+    return m_fd >= 0;
+}
+
+int ConfigFileWatcher::watchCount() const
+{
+    return m_watches.size();
+}
+
+int ConfigFileWatcher::delayTime() const
+{
+    return m_flushTimer.interval();
+}
+
+void ConfigFileWatcher::setDelayTime(const int ms)
+{
+    m_flushTimer.setInterval(ms);
+}
+
+void ConfigFileWatcher::onActivated()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[4096];
+    forever {
+        const auto length = ::read(m_fd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                qCWarning(cfLog) << "Inotify event queue overflowed.";
+                Q_EMIT overflowed();
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                removeWatch(event->wd);
+                continue;
+            }
+
+            const auto iter = m_watches.constFind(event->wd);
+            if (iter == m_watches.constEnd())
+                continue;
+
+            if (m_ancestorWatches.contains(event->wd)) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    watchRoots(true);
+                continue;
+            }
+
+            const QString name = event->len > 0 ? QString::fromLocal8Bit(event->name) : QString();
+            const QString path = name.isEmpty() ? iter.value() : iter.value() + QLatin1Char('/') + name;
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    // files may be created before the directory is watched.
+                    addDirectory(path, true);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    pushChangedFile(path);
+                }
+            } else if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                pushChangedFile(iter.value());
+                // the root may be created again.
+                if (m_roots.contains(iter.value()))
+                    QTimer::singleShot(0, this, [this]() { watchRoots(true); });
+            } else if (isConfigureFile(name)) {
+                pushChangedFile(path);
+            }
+        }
+    }
+#endif // Q_OS_LINUX
+}
+
+void ConfigFileWatcher::flushChangedFiles()
+{
+    if (m_changedFiles.isEmpty())
+        return;
+
+    const QStringList paths(m_changedFiles.begin(), m_changedFiles.end());
+    m_changedFiles.clear();
+    qCDebug(cfLog) << "Configuration files changed:" << paths;
+    Q_EMIT filesChanged(paths);
+}
+
+/*
+  \internal
+
+    \breaf watch the existing roots recursively, and the nearest existing ancestor of
+    the not existing root to know when it's created, files of the new root are reported if `scan` is true.
+*/
+void ConfigFileWatcher::watchRoots(bool scan)
+{
+    for (const auto &root : std::as_const(m_roots)) {
+        if (QDir(root).exists()) {
+            if (!m_directories.contains(root))
+                addDirectory(root, scan);
+            continue;
+        }
+
+        QDir ancestor(root);
+        while (!ancestor.exists() && !ancestor.isRoot()) {
+            if (!ancestor.cdUp())
+                break;
+        }
+        const auto &path = ancestor.absolutePath();
+        if (!m_directories.contains(path))
+            addWatch(path, true);
+    }
+}
+
+void ConfigFileWatcher::addDirectory(const QString &directory, bool scan)
+{
+    if (addWatch(directory, false) < 0)
+        return;
+
+    QDirIterator iterator(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    while (iterator.hasNext()) {
+        iterator.next();
+        const auto &info = iterator.fileInfo();
+        if (info.isDir()) {
+            addWatch(info.absoluteFilePath(), false);
+        } else if (scan && isConfigureFile(info.fileName())) {
+            pushChangedFile(info.absoluteFilePath());
+        }
+    }
+}
+
+int ConfigFileWatcher::addWatch(const QString &directory, bool ancestor)
+{
+#ifdef Q_OS_LINUX
+    const uint32_t mask = ancestor ? (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR)
+                                   : (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                                      | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+    const int wd = inotify_add_watch(m_fd, QFile::encodeName(directory).constData(), mask);
+    if (wd < 0) {
+        qCWarning(cfLog) << "Failed to watch directory:" << directory << strerror(errno);
+        return wd;
+    }
+    // the same directory gets the same wd, watching the root replaces the watch of the ancestor.
+    m_watches.insert(wd, directory);
+    m_directories.insert(directory, wd);
+    if (ancestor) {
+        m_ancestorWatches.insert(wd);
+    } else {
+        m_ancestorWatches.remove(wd);
+    }
+    return wd;
+#else
+    Q_UNUSED(directory)
+    Q_UNUSED(ancestor)
+    return -1;
+#endif // Q_OS_LINUX
+}
+
+void ConfigFileWatcher::removeWatch(const int wd)
+{
+    const auto &directory = m_watches.take(wd);
+    if (m_directories.value(directory) == wd)
+        m_directories.remove(directory);
+    m_ancestorWatches.remove(wd);
+}
+
+void ConfigFileWatcher::pushChangedFile(const QString &path)
+{
+    m_changedFiles.insert(path);
+    if (!m_flushTimer.isActive())
+        m_flushTimer.start();
+}
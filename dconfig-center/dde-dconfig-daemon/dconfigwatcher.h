@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+class QSocketNotifier;
+
+/**
+ * @brief The ConfigFileWatcher class
+ * 通过inotify递归监控配置描述文件目录，合并一段时间内的变化后通知发生变化的配置文件，
+ * 被移除的目录以目录路径通知，尚未创建的目录在创建后自动加入监控。
+ */
+class ConfigFileWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ConfigFileWatcher(QObject *parent = nullptr);
+    virtual ~ConfigFileWatcher() override;
+
+    bool start(const QStringList &directories);
+    void stop();
+    bool isActive() const;
+    int watchCount() const;
+
+    int delayTime() const;
+    void setDelayTime(const int ms);
+
+Q_SIGNALS:
+    void filesChanged(const QStringList &paths);
+    // events are dropped by the kernel, all directories should be scanned again.
+    void overflowed();
+
+private Q_SLOTS:
+    void onActivated();
+    void flushChangedFiles();
+
+private:
+    void watchRoots(bool scan);
+    void addDirectory(const QString &directory, bool scan);
+    int addWatch(const QString &directory, bool ancestor);
+    void removeWatch(const int wd);
+    void pushChangedFile(const QString &path);
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QStringList m_roots;
+    // wd -> directory, watches of ancestors of not existing roots are in `m_ancestorWatches`.
+    QHash<int, QString> m_watches;
+    QHash<QString, int> m_directories;
+    QSet<int> m_ancestorWatches;
+    QSet<QString> m_changedFiles;
+    QTimer m_flushTimer;
+};
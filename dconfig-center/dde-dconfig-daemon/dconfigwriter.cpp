@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "dconfigwriter.h"
+#include "dconfig_global.h"
+#include "dconfigstats.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryDir>
+
+ConfigPersistenceWriter::ConfigPersistenceWriter(QObject *parent)
+    : QThread(parent)
+{
+    setObjectName(QStringLiteral("ConfigPersistenceWriter"));
+    start(QThread::LowPriority);
+}
+
+ConfigPersistenceWriter::~ConfigPersistenceWriter()
+{
+    stop();
+}
+
+/*!
+ \brief 在主线程中由DTK将对象保存到临时目录，读取生成的文件作为快照，之后对象可以被修改或释放
+ \a id 被保存对象的ID
+ \a save 保存对象的方法，参数为保存的根目录
+ \a localPrefix 对象实际保存的根目录
+ \return 文件快照，临时目录不可用时直接保存到实际目录并返回空
+ */
+QList<ConfigFileSnapshot> ConfigPersistenceWriter::capture(const QString &id, const std::function<bool(const QString &)> &save, const QString &localPrefix)
+{
+    if (!m_stagingDirectory) {
+        // `RUNTIME_DIRECTORY` is set by systemd, it's in memory.
+        const char *runtimeDirectory("RUNTIME_DIRECTORY");
+        const QString &parent = qEnvironmentVariableIsEmpty(runtimeDirectory) ? QDir::tempPath()
+                                                                             : qEnvironmentVariable(runtimeDirectory).split(QLatin1Char(':')).first();
+        m_stagingDirectory.reset(new QTemporaryDir(parent + QStringLiteral("/staging-XXXXXX")));
+    }
+
+    QList<ConfigFileSnapshot> result;
+    if (!m_stagingDirectory->isValid()) {
+        qCWarning(cfLog) << "Save synchronously because the staging directory is unavailable:" << m_stagingDirectory->errorString();
+        if (!save(localPrefix))
+            recordFailure(id);
+        return result;
+    }
+
+    const QString staging = m_stagingDirectory->path();
+    if (!save(staging))
+        qCWarning(cfLog) << "Failed to serialize the configuration into the staging directory.";
+
+    // only the files of this object are in it, they are removed after read.
+    QDirIterator iter(staging, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (iter.hasNext()) {
+        const QString &path = iter.next();
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            qCWarning(cfLog) << "Failed to read the serialized configuration:" << path << file.errorString();
+            continue;
+        }
+        result << ConfigFileSnapshot{localPrefix + path.mid(staging.size()), file.readAll()};
+        file.close();
+        file.remove();
+    }
+    return result;
+}
+
+/*!
+ \brief 提交文件快照，同一ID的快照按提交顺序写入
+ \a id 被保存对象的ID，如连接的键或资源的键
+ \a snapshots 在主线程中生成的文件快照
+ */
+void ConfigPersistenceWriter::write(const QString &id, const QList<ConfigFileSnapshot> &snapshots)
+{
+    if (snapshots.isEmpty())
+        return;
+
+    post(id, [this, id, snapshots]() {
+        for (const auto &snapshot : snapshots) {
+            if (!writeFile(snapshot)) {
+                recordFailure(id);
+                continue;
+            }
+            if (m_statistics)
+                m_statistics->addBytesWritten(static_cast<quint64>(snapshot.content.size()));
+        }
+    });
+}
+
+/*!
+ \brief 提交任务，写线程已停止时在当前线程直接执行
+ \a id 被保存对象的ID，如连接的键或资源的键
+ \a job 保存任务
+ */
+void ConfigPersistenceWriter::post(const QString &id, const Job &job)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_stopping) {
+            m_jobs.enqueue(qMakePair(id, job));
+            ++m_pending[id];
+            ++m_pendingCount;
+            m_jobAvailable.wakeOne();
+            return;
+        }
+    }
+    job();
+}
+
+/*!
+ \brief 等待指定ID的所有任务完成
+ */
+void ConfigPersistenceWriter::wait(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_pending.contains(id))
+        m_jobDone.wait(&m_mutex);
+}
+
+/*!
+ \brief 等待所有任务完成
+ */
+void ConfigPersistenceWriter::drain()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_pendingCount > 0)
+        qCDebug(cfLog, "Drain persistence writer, pending jobs:%d.", m_pendingCount);
+
+    while (m_pendingCount > 0)
+        m_jobDone.wait(&m_mutex);
+}
+
+/*!
+ \brief 完成所有任务后结束写线程，之后提交的任务直接执行
+ */
+void ConfigPersistenceWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_jobAvailable.wakeAll();
+    }
+    QThread::wait();
+}
+
+int ConfigPersistenceWriter::pendingCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pendingCount;
+}
+
+/*!
+ \brief 取出上次调用后写入失败的对象，它们的修改记录需要保留到再次保存
+ */
+QStringList ConfigPersistenceWriter::takeFailedIds()
+{
+    QMutexLocker locker(&m_mutex);
+    QStringList result;
+    result.swap(m_failedIds);
+    return result;
+}
+
+void ConfigPersistenceWriter::recordFailure(const QString &id)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_failedIds.contains(id))
+        m_failedIds << id;
+}
+
+/*!
+ \brief 以原子替换的方式写入文件，写入后同步到磁盘
+ \return 是否写入成功
+ */
+bool ConfigPersistenceWriter::writeFile(const ConfigFileSnapshot &snapshot)
+{
+    if (!QDir().mkpath(QFileInfo(snapshot.path).path())) {
+        qCWarning(cfLog) << "Failed to create the directory of the configuration:" << snapshot.path;
+        return false;
+    }
+
+    QSaveFile file(snapshot.path);
+    if (!file.open(QIODevice::WriteOnly) || file.write(snapshot.content) != snapshot.content.size() || !file.commit()) {
+        qCWarning(cfLog) << "Failed to write the configuration:" << snapshot.path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/*!
+ \brief 设置统计对象，记录每个任务的耗时及写入文件快照的字节数，在提交任务前设置
+ */
+void ConfigPersistenceWriter::setStatistics(ConfigStatistics *statistics)
+{
+    m_statistics = statistics;
+}
+
+void ConfigPersistenceWriter::run()
+{
+    forever {
+        QPair<QString, Job> job;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_jobs.isEmpty() && !m_stopping)
+                m_jobAvailable.wait(&m_mutex);
+
+            if (m_jobs.isEmpty())
+                return;
+
+            job = m_jobs.dequeue();
+        }
+
+        auto statistics = m_statistics;
+        if (statistics) {
+            QElapsedTimer timer;
+            timer.start();
+            job.second();
+            statistics->record(ConfigStatistics::SyncWrite, timer.nsecsElapsed() / 1000);
+        } else {
+            job.second();
+        }
+
+        QMutexLocker locker(&m_mutex);
+        auto iter = m_pending.find(job.first);
+        if (iter != m_pending.end() && --iter.value() <= 0)
+            m_pending.erase(iter);
+        --m_pendingCount;
+        m_jobDone.wakeAll();
+    }
+}
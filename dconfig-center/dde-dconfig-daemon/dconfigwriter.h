@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QHash>
+#include <functional>
+#include <memory>
+
+class ConfigStatistics;
+class QTemporaryDir;
+
+/**
+ * @brief The ConfigFileSnapshot struct
+ * 在主线程中序列化的文件内容及其保存路径
+ */
+struct ConfigFileSnapshot
+{
+    QString path;
+    QByteArray content;
+};
+
+/**
+ * @brief The ConfigPersistenceWriter class
+ * 在独立线程中按提交顺序写入主线程生成的文件快照，写线程不访问缓存对象，
+ * 主线程重新加载同一文件前等待该ID的任务完成。
+ */
+class ConfigPersistenceWriter : public QThread
+{
+    Q_OBJECT
+public:
+    using Job = std::function<void()>;
+
+    explicit ConfigPersistenceWriter(QObject *parent = nullptr);
+    virtual ~ConfigPersistenceWriter() override;
+
+    QList<ConfigFileSnapshot> capture(const QString &id, const std::function<bool(const QString &)> &save, const QString &localPrefix);
+    void write(const QString &id, const QList<ConfigFileSnapshot> &snapshots);
+    void post(const QString &id, const Job &job);
+    void wait(const QString &id);
+    void drain();
+    void stop();
+
+    int pendingCount() const;
+    QStringList takeFailedIds();
+    void setStatistics(ConfigStatistics *statistics);
+
+    static bool writeFile(const ConfigFileSnapshot &snapshot);
+
+protected:
+    void run() override;
+
+private:
+    void recordFailure(const QString &id);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_jobAvailable;
+    QWaitCondition m_jobDone;
+    QQueue<QPair<QString, Job>> m_jobs;
+    // id -> count of the queued and running jobs.
+    QHash<QString, int> m_pending;
+    int m_pendingCount = 0;
+    bool m_stopping = false;
+    // ids of the objects failed to be written since taken last time.
+    QStringList m_failedIds;
+    // DTK saves the objects into it on the main thread.
+    std::unique_ptr<QTemporaryDir> m_stagingDirectory;
+    // set before jobs are posted, it's destroyed after the writer is stopped.
+    ConfigStatistics *m_statistics = nullptr;
+};
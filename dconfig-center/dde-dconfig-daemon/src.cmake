@@ -10,6 +10,10 @@ qt5_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktop
 qt5_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Manager.xml
     dconfigconn.h DSGConfigConn
     manager_adaptor DSGConfigManagerAdaptor)
+
+qt5_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Stats.xml
+    dconfigserver.h DSGConfigServer
+    configmanagerstats_adaptor DSGConfigStatsAdaptor)
 endif()
 
 if(EnableDtk6)
@@ -20,6 +24,10 @@ qt_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktops
 qt_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Manager.xml
     dconfigconn.h DSGConfigConn
     manager_adaptor DSGConfigManagerAdaptor)
+
+qt_add_dbus_adaptor(DCONFIG_DBUS_XML ../dde-dconfig-daemon/services/org.desktopspec.ConfigManager.Stats.xml
+    dconfigserver.h DSGConfigServer
+    configmanagerstats_adaptor DSGConfigStatsAdaptor)
 endif()
 
 include_directories(../common)
@@ -30,10 +38,32 @@ set(HEADERS
     ${CMAKE_CURRENT_LIST_DIR}/dconfigresource.h
     ${CMAKE_CURRENT_LIST_DIR}/dconfigconn.h
     ${CMAKE_CURRENT_LIST_DIR}/dconfigrefmanager.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcredentials.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwriter.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigjournal.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwatcher.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigmetastore.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigaccessprofile.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigsnapshot.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigchannel.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigloader.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigdependency.h
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigstats.h
 )
 set(SOURCES
     ${CMAKE_CURRENT_LIST_DIR}/dconfigserver.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigresource.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigconn.cpp
     ${CMAKE_CURRENT_LIST_DIR}/dconfigrefmanager.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigcredentials.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwriter.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigjournal.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigwatcher.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigmetastore.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigaccessprofile.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigsnapshot.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigchannel.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigloader.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigdependency.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/dconfigstats.cpp
 )
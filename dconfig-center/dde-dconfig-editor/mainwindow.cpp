@@ -320,14 +320,7 @@ void MainWindow::onCustomResourceMenuRequested(const QString &appid, const QStri
             qWarning() << "Failed to create manager for reset command";
             return;
         }
-        const auto keys = manager->keyList();
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-        for (const auto &item : std::as_const(keys)) {
-#else
-        for (const auto &item : qAsConst(keys)) {
-#endif
-            manager->reset(item);
-        }
+        manager->resetAll();
         refreshResourceKeys(appid, resource, subpath);
      });
      menu.exec(QCursor::pos());
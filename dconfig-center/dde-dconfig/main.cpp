@@ -327,14 +327,7 @@ int CommandManager::resetCommand()
             if (isSetKey()) {
                 manager->reset(key);
             } else {
-                const auto keys = manager->keyList();
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-                for (const auto &item : std::as_const(keys)) {
-#else
-                for (const auto &item : qAsConst(keys)) {
-#endif
-                    manager->reset(item);
-                }
+                manager->resetAll();
             }
         } else {
             outpuSTDError(QString("not create value handler for appid=%1, resource=%2, subpath=%3.").arg(appid, resourceid, subpathid));
@@ -0,0 +1,40 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QTemporaryDir>
+
+#include <gtest/gtest.h>
+
+#include "dconfigaccessprofile.h"
+
+TEST(ut_ConfigAccessProfile, hottest) {
+    const qint64 now = 1000000000;
+    const qint64 day = 24 * 3600;
+    ConfigAccessProfile profile;
+    profile.record("org.foo.appid", "example", "", now);
+    profile.record("org.foo.appid", "example", "", now);
+    profile.record("org.foo.appid", "example", "/a", now);
+    // acquired frequently, but a month ago.
+    for (int i = 0; i < 4; i++)
+        profile.record("org.foo.other", "example", "", now - 30 * day);
+    ASSERT_EQ(profile.size(), 3);
+
+    auto records = profile.hottest(2, now);
+    ASSERT_EQ(records.size(), 2);
+    ASSERT_EQ(records[0].subpath, QString(""));
+    ASSERT_EQ(records[0].appid, QString("org.foo.appid"));
+    ASSERT_EQ(records[0].count, 2u);
+    ASSERT_EQ(records[1].subpath, QString("/a"));
+
+    QTemporaryDir directory;
+    ASSERT_TRUE(directory.isValid());
+    const QString path(directory.filePath("access-profile"));
+    ASSERT_TRUE(profile.save(path, 2));
+    ConfigAccessProfile loaded;
+    ASSERT_TRUE(loaded.load(path));
+    ASSERT_EQ(loaded.size(), 2);
+
+    loaded.remove(getResourceKey("org.foo.appid", getGenericResourceKey("example", "/a")));
+    ASSERT_EQ(loaded.size(), 1);
+}
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <gtest/gtest.h>
+
+#include <unistd.h>
+
+#include "dconfigchannel.h"
+#include "dconfigcredentials.h"
+#include "dconfigserver.h"
+#include "test_helper.hpp"
+
+template<class Predicate>
+static bool waitFor(Predicate predicate, int timeout = 5000)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!predicate() && timer.elapsed() < timeout)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    return predicate();
+}
+
+static QString socketPath(const QString &address)
+{
+    return address.mid(QStringLiteral("unix:path=").size()).section(QLatin1Char(','), 0, 0);
+}
+
+TEST(ut_ConfigDirectChannels, openDirectChannel) {
+    QTemporaryDir runtimeDirectory;
+    ASSERT_TRUE(runtimeDirectory.isValid());
+    EnvGuard runtimeDirectoryGuard;
+    runtimeDirectoryGuard.set("RUNTIME_DIRECTORY", runtimeDirectory.path().toLocal8Bit());
+
+    DSGConfigServer server;
+    PeerCredentialsCache credentialsCache;
+    ConfigDirectChannels channels(&server, &credentialsCache);
+    runtimeDirectoryGuard.restore();
+    ASSERT_TRUE(channels.isAvailable());
+
+    // the peer of other user is rejected, the channel is kept for its opener.
+    PeerCredentials credentials;
+    credentials.uid = ::getuid() + 1;
+    QString errorMsg;
+    const auto otherAddress = channels.open(credentials, errorMsg);
+    ASSERT_FALSE(otherAddress.isEmpty());
+    const QString otherName("ut_ConfigDirectChannels_other");
+    QDBusConnection::connectToPeer(otherAddress, otherName);
+    ASSERT_TRUE(waitFor([&otherName]() { return !QDBusConnection(otherName).isConnected(); }));
+    ASSERT_TRUE(QFile::exists(socketPath(otherAddress)));
+    ASSERT_EQ(credentialsCache.size(), 0);
+    QDBusConnection::disconnectFromPeer(otherName);
+
+    // the opener is accepted, the socket is removed once connected.
+    credentials.uid = ::getuid();
+    const auto address = channels.open(credentials, errorMsg);
+    ASSERT_FALSE(address.isEmpty());
+    ASSERT_EQ(channels.count(), 2);
+    const QString name("ut_ConfigDirectChannels_opener");
+    QDBusConnection::connectToPeer(address, name);
+    ASSERT_TRUE(waitFor([&address]() { return !QFile::exists(socketPath(address)); }));
+    ASSERT_TRUE(QDBusConnection(name).isConnected());
+    ASSERT_EQ(credentialsCache.size(), 1);
+
+    // the channel is closed and the peer's credentials are dropped after it's disconnected.
+    QSignalSpy spy(&channels, &ConfigDirectChannels::closed);
+    QDBusConnection::disconnectFromPeer(name);
+    ASSERT_TRUE(spy.wait(10000));
+    ASSERT_EQ(credentialsCache.size(), 0);
+
+    channels.closeAll();
+    ASSERT_EQ(channels.count(), 0);
+    ASSERT_FALSE(QFile::exists(socketPath(otherAddress)));
+}
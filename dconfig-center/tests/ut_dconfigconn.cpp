@@ -7,11 +7,19 @@
 #include <QLocale>
 #include <QSignalSpy>
 #include <QDir>
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 #include <gtest/gtest.h>
 
 #include "dconfigresource.h"
 #include "dconfigconn.h"
+#include "dconfigmetastore.h"
+#include "dconfigsnapshot.h"
+#include "dconfigloader.h"
+
+#include <sys/mman.h>
 #include "test_helper.hpp"
 
 static constexpr char const *LocalPrefix = "/tmp/example/";
@@ -91,6 +99,144 @@ TEST_F(ut_DConfigResource, getConn) {
 
     ASSERT_EQ(resource->connSize(), 2);
 }
+TEST_F(ut_DConfigResource, connKey) {
+
+    resource->load(APP_ID);
+    auto conn = resource->createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->key(), resource->getConnKey(APP_ID, TestUid));
+    ASSERT_EQ(conn->resourceKey(), getResourceKey(APP_ID, resource->key()));
+    ASSERT_EQ(conn->uid(), static_cast<uint>(TestUid));
+    ASSERT_EQ(conn->path(), QString("/org_foo_appid/example/%1").arg(TestUid));
+}
+TEST_F(ut_DConfigResource, getConnectionsByUid) {
+
+    const uint otherUid = 1;
+    resource->load(APP_ID);
+    resource->load(VirtualInterAppId);
+    ASSERT_TRUE(resource->createConn(APP_ID, TestUid));
+    ASSERT_TRUE(resource->createConn(VirtualInterAppId, TestUid));
+    ASSERT_TRUE(resource->createConn(APP_ID, otherUid));
+
+    ASSERT_EQ(resource->getConnectionsByUid(TestUid).size(), 2);
+    ASSERT_EQ(resource->getConnectionsByUid(otherUid), QList<ConnKey>{resource->getConnKey(APP_ID, otherUid)});
+
+    resource->removeConn(resource->getConnKey(APP_ID, otherUid));
+    ASSERT_TRUE(resource->getConnectionsByUid(otherUid).isEmpty());
+    ASSERT_EQ(resource->connSize(), 2);
+}
+TEST_F(ut_DConfigResource, metaIndex) {
+
+    resource->load(APP_ID);
+    auto index = resource->metaIndex(getResourceKey(APP_ID, resource->key()));
+    ASSERT_TRUE(index);
+    ASSERT_EQ(index->size(), 8);
+    ASSERT_TRUE(index->contains("canExit"));
+    ASSERT_TRUE(index->value("array").flags.testFlag(DConfigFile::Global));
+    ASSERT_EQ(index->value("canExit").visibility, DConfigFile::Private);
+    ASSERT_EQ(resource->metaIndex(getResourceKey("notexist.appid", resource->key())), nullptr);
+}
+TEST_F(ut_DConfigResource, metaStore) {
+
+    ConfigMetaStore store;
+    resource->setMetaStore(&store);
+    const auto resourceKey = getResourceKey(APP_ID, resource->key());
+
+    resource->load(APP_ID);
+    auto conn = resource->createConn(APP_ID, TestUid);
+    ASSERT_TRUE(conn);
+    resource->removeConn(conn->key());
+    ASSERT_EQ(resource->getFile(resourceKey), nullptr);
+    ASSERT_TRUE(store.contains(resourceKey));
+
+    // the stored file is reused.
+    ASSERT_TRUE(resource->load(APP_ID));
+    ASSERT_FALSE(store.contains(resourceKey));
+    ASSERT_EQ(resource->metaIndex(resourceKey)->size(), 8);
+
+    store.put(resourceKey, new DConfigFile(APP_ID, FILE_NAME));
+    ASSERT_EQ(store.size(), 1);
+    store.invalidate(resource->key());
+    ASSERT_EQ(store.size(), 0);
+
+    store.setCapacity(0);
+    resource.reset();
+    ASSERT_EQ(store.size(), 0);
+}
+TEST_F(ut_DConfigResource, metaDiff) {
+
+    const QString prefix = QString("%1/diff").arg(LocalPrefix);
+    const QString path = QString("%1/usr/share/dsg/configs/%2/%3.json").arg(prefix, APP_ID, FILE_NAME);
+    QFile source(":/config/example.json");
+    ASSERT_TRUE(source.open(QIODevice::ReadOnly));
+    auto doc = QJsonDocument::fromJson(source.readAll());
+    auto root = doc.object();
+    auto contents = root["contents"].toObject();
+    contents.insert("newKey", contents["key2"]);
+    contents.remove("canExit");
+    auto key2 = contents["key2"].toObject();
+    key2["value"] = "126";
+    contents["key2"] = key2;
+    auto array = contents["array"].toObject();
+    array["permissions"] = "readonly";
+    contents["array"] = array;
+    root["contents"] = contents;
+
+    ASSERT_TRUE(QDir().mkpath(QFileInfo(path).path()));
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(root).toJson());
+    file.close();
+
+    DConfigFile oldFile(APP_ID, FILE_NAME);
+    ASSERT_TRUE(oldFile.load(LocalPrefix));
+    DConfigFile newFile(APP_ID, FILE_NAME);
+    ASSERT_TRUE(newFile.load(prefix));
+
+    ASSERT_TRUE(DSGConfigResource::metaDiff(oldFile.meta(), oldFile.meta()).isEmpty());
+    const auto &diff = DSGConfigResource::metaDiff(oldFile.meta(), newFile.meta());
+    ASSERT_EQ(diff.added, QStringList{"newKey"});
+    ASSERT_EQ(diff.removed, QStringList{"canExit"});
+    ASSERT_EQ(diff.readOnly, QStringList{"array"});
+    ASSERT_EQ(QSet<QString>(diff.changed.begin(), diff.changed.end()), QSet<QString>({"key2", "array"}));
+
+    QDir(prefix).removeRecursively();
+}
+
+TEST_F(ut_DConfigResource, fileLoader) {
+
+    ConfigFileLoader loader;
+    QList<QPair<ResourceKey, DConfigFile *>> results;
+    QObject::connect(&loader, &ConfigFileLoader::loaded, [&results](const ResourceKey &key, DConfigFile *file) {
+        results << qMakePair(key, file);
+    });
+    auto waitForLoaded = [&loader]() {
+        for (int i = 0; i < 100 && loader.pendingCount() > 0; ++i)
+            QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents, 50);
+    };
+    const auto resourceKey = getResourceKey(APP_ID, resource->key());
+
+    // concurrent loads of the same file share one parsing.
+    ASSERT_TRUE(loader.load(APP_ID, FILE_NAME, "", LocalPrefix));
+    ASSERT_FALSE(loader.load(APP_ID, FILE_NAME, "", LocalPrefix));
+    ASSERT_TRUE(loader.isLoading(resourceKey));
+    waitForLoaded();
+    ASSERT_EQ(results.size(), 1);
+    ASSERT_EQ(results.first().first, resourceKey);
+    std::unique_ptr<DConfigFile> file(results.first().second);
+    ASSERT_TRUE(file);
+    ASSERT_EQ(file->meta()->keyList().size(), 8);
+    ASSERT_FALSE(loader.isLoading(resourceKey));
+
+    // the file changed while loading is discarded.
+    results.clear();
+    ASSERT_TRUE(loader.load(APP_ID, FILE_NAME, "", LocalPrefix));
+    loader.invalidate(resource->key());
+    waitForLoaded();
+    ASSERT_EQ(results.size(), 1);
+    ASSERT_EQ(results.first().second, nullptr);
+}
+
 TEST_F(ut_DConfigResource, fallbackToGenericConfig) {
 
     resource->load(APP_ID);
@@ -177,6 +323,24 @@ TEST_F(ut_DConfigConn, reset) {
     ASSERT_EQ(spy.count(), 1);
 }
 
+TEST_F(ut_DConfigConn, noopWrite) {
+    conn->setValue("canExit", QDBusVariant{false});
+
+    QSignalSpy spy(conn, &DSGConfigConn::valueChanged);
+    conn->setValue("canExit", QDBusVariant{false});
+    ASSERT_EQ(spy.count(), 0);
+
+    conn->reset("canExit");
+    ASSERT_EQ(spy.count(), 1);
+    conn->reset("canExit");
+    ASSERT_EQ(spy.count(), 1);
+
+    conn->resetAll();
+    QSignalSpy batchSpy(conn, &DSGConfigConn::batchValueChanged);
+    conn->resetAll();
+    ASSERT_EQ(batchSpy.count(), 0);
+}
+
 TEST_F(ut_DConfigConn, visibility) {
 
     ASSERT_EQ(conn->visibility("canExit"), "private");
@@ -235,3 +399,127 @@ TEST_F(ut_DConfigConn, isDefaultValue) {
     conn->reset("canExit");
     ASSERT_TRUE(conn->isDefaultValue("canExit"));
 }
+
+TEST_F(ut_DConfigConn, values) {
+    conn->setValue("canExit", QDBusVariant{false});
+
+    QVariantMap errors;
+    const auto result = conn->values({"canExit", "key2", "notExistKey"}, errors);
+    ASSERT_EQ(result.size(), 2);
+    ASSERT_EQ(result.value("canExit"), false);
+    ASSERT_EQ(result.value("key2").toString(), "125");
+    ASSERT_EQ(errors.size(), 1);
+    ASSERT_TRUE(errors.contains("notExistKey"));
+
+    QVariantMap allErrors;
+    const auto all = conn->values({}, allErrors);
+    ASSERT_EQ(all.size(), conn->keyList().size());
+    ASSERT_TRUE(allErrors.isEmpty());
+}
+
+TEST_F(ut_DConfigConn, setValues) {
+    conn->resetAll();
+
+    QSignalSpy spy(conn, &DSGConfigConn::batchValueChanged);
+    QVariantMap values;
+    values.insert("canExit", false);
+    values.insert("key2", "256");
+    conn->setValues(values);
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(conn->value("canExit").variant(), false);
+    ASSERT_EQ(conn->value("key2").variant().toString(), "256");
+
+    // nothing is written if any key is invalid.
+    values.insert("canExit", true);
+    values.insert("notExistKey", true);
+    conn->setValues(values);
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(conn->value("canExit").variant(), false);
+}
+
+TEST_F(ut_DConfigConn, resetAll) {
+    QVariantMap values;
+    values.insert("canExit", false);
+    values.insert("key2", "256");
+    conn->setValues(values);
+
+    QSignalSpy spy(conn, &DSGConfigConn::batchValueChanged);
+    conn->resetAll();
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_TRUE(conn->isDefaultValue("canExit"));
+    ASSERT_TRUE(conn->isDefaultValue("key2"));
+}
+
+TEST_F(ut_DConfigConn, valuesChanged) {
+    conn->resetAll();
+    // drop the notification queued by `resetAll`.
+    QCoreApplication::processEvents();
+    QSignalSpy spy(conn, &DSGConfigConn::valuesChanged);
+
+    conn->setValue("canExit", QDBusVariant{false});
+    conn->setValue("key2", QDBusVariant{"256"});
+    conn->setValue("canExit", QDBusVariant{true});
+    ASSERT_EQ(spy.count(), 0);
+
+    ASSERT_TRUE(spy.wait(100));
+    ASSERT_EQ(spy.count(), 1);
+    auto keys = spy.takeFirst().at(0).toStringList();
+    keys.sort();
+    ASSERT_EQ(keys, QStringList({"canExit", "key2"}));
+}
+
+TEST_F(ut_DConfigConn, valueCache) {
+    const QStringList origin{"value1", "value2"};
+    ASSERT_EQ(conn->value("array").variant().toStringList(), origin);
+
+    // global value changed by other user's connection.
+    const uint otherUid = 1;
+    auto otherConn = resource->createConn(APP_ID, otherUid);
+    ASSERT_TRUE(otherConn);
+    const QStringList changed{"value3"};
+    otherConn->setValue("array", QDBusVariant{changed});
+    ASSERT_EQ(conn->value("array").variant().toStringList(), changed);
+
+    otherConn->reset("array");
+    ASSERT_EQ(conn->value("array").variant().toStringList(), origin);
+}
+
+TEST_F(ut_DConfigConn, valuesSnapshot) {
+    conn->reset("key2");
+    QCoreApplication::processEvents();
+
+    const auto fd = conn->valuesSnapshot();
+    ASSERT_TRUE(fd.isValid());
+    const auto size = static_cast<size_t>(lseek(fd.fileDescriptor(), 0, SEEK_END));
+    auto data = static_cast<const uchar *>(mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.fileDescriptor(), 0));
+    ASSERT_NE(data, MAP_FAILED);
+
+    QVariantMap values;
+    ASSERT_TRUE(ConfigValueSnapshot::read(data, size, values));
+    ASSERT_EQ(values.value("key2").toString(), QString("125"));
+
+    conn->setValue("key2", QDBusVariant{"126"});
+    QCoreApplication::processEvents();
+    ASSERT_TRUE(ConfigValueSnapshot::read(data, size, values));
+    ASSERT_EQ(values.value("key2").toString(), QString("126"));
+
+    // it's invalid after the connection is removed.
+    resource->removeConn(conn->key());
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+    ASSERT_FALSE(ConfigValueSnapshot::read(data, size, values));
+    munmap(const_cast<uchar *>(data), size);
+}
+
+TEST_F(ut_DConfigConn, fallbackToGenericConfigChanged) {
+    ASSERT_TRUE(resource->fallbackToGenericConfig());
+
+    QFile::rename(noAppIdConfigPath(), noAppIdConfigPath() + ".bak");
+    // it's memoized until invalidated.
+    ASSERT_TRUE(resource->fallbackToGenericConfig());
+    resource->invalidateFallbackToGenericConfig();
+    ASSERT_FALSE(resource->fallbackToGenericConfig());
+
+    QFile::rename(noAppIdConfigPath() + ".bak", noAppIdConfigPath());
+    resource->invalidateFallbackToGenericConfig();
+    ASSERT_TRUE(resource->fallbackToGenericConfig());
+}
@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDBusServiceWatcher>
+
+#include <gtest/gtest.h>
+
+#include "dconfigcredentials.h"
+
+class ut_PeerCredentialsCache : public testing::Test
+{
+protected:
+    virtual void SetUp() override {
+        cache.reset(new PeerCredentialsCache);
+    }
+    // it's not connected to any bus, every request to the bus daemon fails.
+    QDBusConnection connection = QDBusConnection(QStringLiteral("ut_PeerCredentialsCache"));
+    QScopedPointer<PeerCredentialsCache> cache;
+};
+
+TEST_F(ut_PeerCredentialsCache, cached) {
+    PeerCredentials credentials;
+    credentials.uid = 1000;
+    credentials.pid = static_cast<uint>(QCoreApplication::applicationPid());
+    cache->setPeerCredentials(":1.100", credentials);
+    ASSERT_EQ(cache->size(), 1);
+
+    // the cached credentials are used without requesting the bus daemon.
+    uint uid = 0;
+    ASSERT_TRUE(cache->uid(connection, ":1.100", uid));
+    ASSERT_EQ(uid, 1000u);
+
+    PeerCredentials result;
+    ASSERT_TRUE(cache->credentials(connection, ":1.100", result));
+    ASSERT_EQ(result.pid, credentials.pid);
+    ASSERT_FALSE(result.processName.isEmpty());
+    ASSERT_EQ(cache->processName(connection, ":1.100"), result.processName);
+    ASSERT_EQ(cache->size(), 1);
+}
+
+TEST_F(ut_PeerCredentialsCache, failedLookup) {
+    uint uid = 1000;
+    ASSERT_FALSE(cache->uid(connection, ":1.100", uid));
+    // it's not mistaken for root.
+    ASSERT_EQ(uid, 1000u);
+    ASSERT_TRUE(cache->processName(connection, ":1.100").isEmpty());
+    PeerCredentials credentials;
+    ASSERT_FALSE(cache->credentials(connection, ":1.100", credentials));
+
+    // the failed lookup isn't cached or watched, and it's requested again next time.
+    ASSERT_EQ(cache->size(), 0);
+    auto watcher = cache->findChild<QDBusServiceWatcher *>();
+    ASSERT_TRUE(watcher);
+    ASSERT_TRUE(watcher->watchedServices().isEmpty());
+    ASSERT_FALSE(cache->uid(connection, ":1.100", uid));
+    ASSERT_EQ(cache->size(), 0);
+
+    // the peer of the direct channel is never requested from the connection.
+    ASSERT_FALSE(cache->uid(connection, PeerCredentialsCache::peerServiceName("test.peer"), uid));
+    ASSERT_EQ(cache->size(), 0);
+}
+
+TEST_F(ut_PeerCredentialsCache, removeOnDisconnected) {
+    uint uid = 0;
+    ASSERT_FALSE(cache->uid(connection, ":1.100", uid));
+    auto watcher = cache->findChild<QDBusServiceWatcher *>();
+    ASSERT_TRUE(watcher);
+
+    PeerCredentials credentials;
+    credentials.uid = 1000;
+    cache->setPeerCredentials(":1.100", credentials);
+    cache->setPeerCredentials(":1.101", credentials);
+    const auto &peer = PeerCredentialsCache::peerServiceName("test.peer");
+    cache->setPeerCredentials(peer, credentials);
+    ASSERT_EQ(cache->size(), 3);
+
+    // the bus daemon reports the unregistration when the caller exits.
+    Q_EMIT watcher->serviceUnregistered(":1.100");
+    ASSERT_EQ(cache->size(), 2);
+    ASSERT_FALSE(cache->uid(connection, ":1.100", uid));
+    ASSERT_TRUE(cache->uid(connection, ":1.101", uid));
+
+    // the direct channel removes its peer when it's closed.
+    cache->remove(peer);
+    ASSERT_EQ(cache->size(), 1);
+
+    cache->clear();
+    ASSERT_EQ(cache->size(), 0);
+}
@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "dconfigdependency.h"
+
+TEST(ut_ConfigDependencyGraph, affectedFiles) {
+    const QString configs("/usr/share/dsg/configs");
+    const auto appFile = getResourceKey("org.foo.appid", getGenericResourceKey("example", ""));
+    const auto genericFile = getResourceKey(VirtualInterAppId, getGenericResourceKey("example", ""));
+    const auto subpathFile = getResourceKey("org.foo.appid", getGenericResourceKey("example", "/a/b"));
+    const auto otherAppFile = getResourceKey("org.bar.appid", getGenericResourceKey("example", ""));
+    const auto otherFile = getResourceKey("org.foo.appid", getGenericResourceKey("other", ""));
+
+    ConfigDependencyGraph graph;
+    graph.addFile(appFile, configs + "/org.foo.appid/example.json");
+    graph.addFile(genericFile, configs + "/example.json");
+    graph.addFile(subpathFile, configs + "/org.foo.appid/example.json");
+    graph.addFile(otherAppFile, configs + "/example.json");
+    graph.addFile(otherFile, configs + "/org.foo.appid/other.json");
+    ASSERT_EQ(graph.size(), 5);
+
+    auto sorted = [](QList<ResourceKey> keys) {
+        std::sort(keys.begin(), keys.end());
+        return keys;
+    };
+    // generic overrides affect all applications and subpaths.
+    ASSERT_EQ(sorted(graph.affectedFiles(configs + "/overrides/example/a.json")),
+              sorted({appFile, genericFile, subpathFile, otherAppFile}));
+    ASSERT_EQ(graph.affectedFiles(configs + "/overrides/org.foo.appid/example/a/a.json"), QList<ResourceKey>{subpathFile});
+    // the generic meta isn't used by the application having its own meta.
+    ASSERT_EQ(sorted(graph.affectedFiles(configs + "/example.json")), sorted({genericFile, otherAppFile}));
+    // the application's meta may be added for the application using the generic meta.
+    ASSERT_EQ(graph.affectedFiles(configs + "/org.bar.appid/example.json"), QList<ResourceKey>{otherAppFile});
+    ASSERT_TRUE(graph.affectedFiles(configs + "/example.txt").isEmpty());
+
+    graph.removeFile(otherAppFile);
+    ASSERT_FALSE(graph.contains(otherAppFile));
+    ASSERT_EQ(graph.affectedFiles(configs + "/example.json"), QList<ResourceKey>{genericFile});
+}
@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QDir>
+#include <QFile>
+
+#include <gtest/gtest.h>
+
+#include "dconfigjournal.h"
+
+TEST(ut_ConfigJournal, appendAndSeal) {
+    const QString directory("/tmp/example/journal");
+    QDir(directory).removeRecursively();
+
+    ConfigJournal journal;
+    ASSERT_TRUE(journal.open(directory));
+    ASSERT_TRUE(journal.seal().isEmpty());
+
+    ConfigJournalRecord record;
+    record.appid = "org.foo.appid";
+    record.name = "example";
+    record.uid = 1000;
+    record.key = "key2";
+    record.value = QVariant("value");
+    record.callerAppid = "caller";
+    journal.append(record, "/org.foo.appid/example/1000");
+    record.key = "canExit";
+    record.value = QVariant();
+    journal.append(record, "/org.foo.appid/example/1000");
+
+    const auto segment = journal.seal();
+    ASSERT_FALSE(segment.isEmpty());
+    // a new segment is opened after sealed.
+    ASSERT_EQ(ConfigJournal::segments(directory).first(), segment);
+
+    auto records = ConfigJournal::readSegment(segment);
+    ASSERT_EQ(records.size(), 2);
+    ASSERT_EQ(records[0].appid, QString("org.foo.appid"));
+    ASSERT_EQ(records[0].uid, 1000u);
+    ASSERT_EQ(records[0].key, QString("key2"));
+    ASSERT_EQ(records[0].value.toString(), QString("value"));
+    ASSERT_EQ(records[1].key, QString("canExit"));
+    ASSERT_FALSE(records[1].value.isValid());
+
+    // incomplete tail is ignored.
+    QFile file(segment);
+    ASSERT_TRUE(file.resize(file.size() - 1));
+    ASSERT_EQ(ConfigJournal::readSegment(segment).size(), 1);
+
+    journal.close();
+    QDir(directory).removeRecursively();
+}
+
+TEST(ut_ConfigJournal, checkpoint) {
+    const QString directory("/tmp/example/journal");
+    QDir(directory).removeRecursively();
+
+    ConfigJournal journal;
+    ASSERT_TRUE(journal.open(directory));
+
+    ConfigJournalRecord record;
+    record.name = "example";
+    record.key = "key2";
+    record.value = QVariant("value");
+    journal.append(record, "cache1");
+    journal.append(record, "file1");
+    const auto segment1 = journal.seal();
+    journal.append(record, "cache1");
+    const auto segment2 = journal.seal();
+
+    // the segment is needed until all objects modified by it are saved.
+    journal.markSaved("file1");
+    ASSERT_TRUE(journal.takeCheckpointedSegments().isEmpty());
+
+    journal.markSaved("cache1");
+    ASSERT_EQ(journal.takeCheckpointedSegments(), QStringList({segment1, segment2}));
+    ASSERT_TRUE(journal.takeCheckpointedSegments().isEmpty());
+
+    // objects saved before sealed don't keep the segment.
+    journal.append(record, "cache2");
+    journal.markSaved("cache2");
+    const auto segment3 = journal.seal();
+    ASSERT_EQ(journal.takeCheckpointedSegments(), QStringList{segment3});
+
+    journal.close();
+    QDir(directory).removeRecursively();
+}
+
+TEST(ut_ConfigJournal, confirmCheckpoint) {
+    const QString directory("/tmp/example/journal");
+    QDir(directory).removeRecursively();
+
+    ConfigJournal journal;
+    ASSERT_TRUE(journal.open(directory));
+
+    ConfigJournalRecord record;
+    record.name = "example";
+    record.key = "key2";
+    record.value = QVariant("value");
+    journal.append(record, "cache1");
+    const auto segment1 = journal.seal();
+    journal.markSaved("cache1");
+    ASSERT_EQ(journal.takeCheckpointedSegments(), QStringList{segment1});
+    const auto checkpoint1 = journal.lastCheckpoint();
+
+    journal.append(record, "cache2");
+    const auto segment2 = journal.seal();
+    journal.markSaved("cache2");
+    ASSERT_EQ(journal.takeCheckpointedSegments(), QStringList{segment2});
+    const auto checkpoint2 = journal.lastCheckpoint();
+
+    // the snapshot of the first checkpoint failed to be written, newer segments are kept behind it.
+    journal.markUnsaved("cache1");
+    ASSERT_TRUE(journal.confirmCheckpoint(checkpoint1).isEmpty());
+    ASSERT_TRUE(journal.confirmCheckpoint(checkpoint2).isEmpty());
+    ASSERT_TRUE(journal.takeCheckpointedSegments().isEmpty());
+
+    // saved again.
+    journal.markSaved("cache1");
+    ASSERT_EQ(journal.takeCheckpointedSegments(), QStringList({segment1, segment2}));
+    ASSERT_EQ(journal.confirmCheckpoint(journal.lastCheckpoint()), QStringList({segment1, segment2}));
+
+    // confirmed segments are removed by the caller, the empty segment is removed when closed.
+    journal.close();
+    ASSERT_EQ(ConfigJournal::segments(directory), QStringList({segment1, segment2}));
+    QDir(directory).removeRecursively();
+}
@@ -70,6 +70,33 @@ TEST_F(ut_DConfigRefServer, refResource) {
 }
 
 
+TEST_F(ut_DConfigRefServer, references) {
+
+    server->refResource(Service1, Resource1);
+    server->refResource(Service1, Resource1);
+    server->refResource(Service2, Resource1);
+    server->refResource(Service2, Resource2);
+
+    auto references = server->references();
+    ASSERT_EQ(references.size(), 3);
+    int count = 0;
+    for (const auto &reference : references) {
+        if (reference.service == Service1 && reference.key == Resource1)
+            ASSERT_EQ(reference.count, 2);
+        count += reference.count;
+    }
+    ASSERT_EQ(count, 4);
+
+    // references are restored by referring again.
+    QScopedPointer<RefManager> restored(new RefManager);
+    for (const auto &reference : references) {
+        for (int i = 0; i < reference.count; i++)
+            restored->refResource(reference.service, reference.key);
+    }
+    ASSERT_EQ(restored->getRefResourceCountOnTheSR(Service1, Resource1), 2);
+    ASSERT_EQ(restored->getRefResourceCountOnAllService(Resource2), 1);
+}
+
 TEST_F(ut_DConfigRefServer, derefResource) {
 
     server->refResource(Service1, Resource1);
@@ -258,3 +285,58 @@ TEST_F(ut_ConfigSyncRequestCache, base) {
 
     ASSERT_EQ(cache->requestsCount(), 0);
 }
+
+TEST_F(ut_ConfigSyncRequestCache, maxSyncStaleness) {
+    cache->setDelaySyncTime(50);
+    cache->setMaxSyncStaleness(0);
+    ASSERT_EQ(cache->maxSyncStaleness(), 0);
+    cache->setBatchCount(1);
+
+    QSignalSpy spy(cache.data(), &ConfigSyncRequestCache::syncConfigRequest);
+    int syncedCount = 0;
+    QObject::connect(cache.data(), &ConfigSyncRequestCache::syncConfigRequest, [&syncedCount](const ConfigSyncBatchRequest &request) {
+        syncedCount += request.data.size();
+    });
+
+    cache->pushRequest(ConfigSyncRequestCache::userKey("user1"));
+    cache->pushRequest(ConfigSyncRequestCache::userKey("user2"));
+    cache->pushRequest(ConfigSyncRequestCache::userKey("user3"));
+
+    // expired requests are synced in one batch regardless of the batch count.
+    ASSERT_TRUE(spy.wait(1000));
+    ASSERT_EQ(spy.count(), 1);
+    ASSERT_EQ(syncedCount, 3);
+    ASSERT_EQ(cache->requestsCount(), 0);
+}
+
+TEST_F(ut_ConfigSyncRequestCache, adaptiveBatchCount) {
+    cache->setDelaySyncTime(10);
+    // requests are synced in 100 batches at most.
+    cache->setMaxSyncStaleness(1000);
+    cache->setBatchCount(5);
+
+    QSignalSpy spy(cache.data(), &ConfigSyncRequestCache::syncConfigRequest);
+    QList<int> batchSizes;
+    QObject::connect(cache.data(), &ConfigSyncRequestCache::syncConfigRequest, [&batchSizes](const ConfigSyncBatchRequest &request) {
+        batchSizes << request.data.size();
+    });
+
+    for (int i = 0; i < 8; i++)
+        cache->pushRequest(ConfigSyncRequestCache::userKey(QString("user%1").arg(i)));
+
+    ASSERT_TRUE(spy.wait(1000));
+    ASSERT_EQ(batchSizes.first(), 5);
+    while (cache->requestsCount() > 0)
+        ASSERT_TRUE(spy.wait(1000));
+
+    // a backlog is synced in larger batches to keep up with `maxSyncStaleness`.
+    batchSizes.clear();
+    for (int i = 0; i < 2000; i++)
+        cache->pushRequest(ConfigSyncRequestCache::userKey(QString("user%1").arg(i)));
+
+    ASSERT_TRUE(spy.wait(1000));
+    ASSERT_EQ(batchSizes.first(), 20);
+    while (cache->requestsCount() > 0)
+        ASSERT_TRUE(spy.wait(1000));
+    ASSERT_LE(batchSizes.size(), 100);
+}
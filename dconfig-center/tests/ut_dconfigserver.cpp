@@ -3,18 +3,27 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 #include <QBuffer>
+#include <QDataStream>
+#include <QDateTime>
+#include <QCoreApplication>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QSignalSpy>
 #include <QThread>
 
 #include <gtest/gtest.h>
 
+#include <tuple>
+
 #include <DConfigFile>
 
 #include "dconfigserver.h"
 #include "dconfigresource.h"
 #include "dconfigconn.h"
+#include "dconfigcredentials.h"
+#include "dconfigaccessprofile.h"
+#include "dconfigjournal.h"
 #include "test_helper.hpp"
 
 DCORE_USE_NAMESPACE
@@ -91,6 +100,23 @@ TEST_F(ut_DConfigServer, acquireManagerV2) {
     ASSERT_EQ(server->resourceSize(), 1);
 }
 
+TEST_F(ut_DConfigServer, acquireConnection) {
+    // the peer of direct channel isn't registered on the bus.
+    const auto &service = PeerCredentialsCache::peerServiceName("test.peer");
+    ASSERT_TRUE(PeerCredentialsCache::isPeerService(service));
+    ASSERT_FALSE(PeerCredentialsCache::isPeerService("test.service"));
+
+    QString errorMsg;
+    auto conn = server->acquireConnection(service, TestUid, APP_ID, FILE_NAME, QString(""), errorMsg);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->path(), formatDBusObjectPath(QString("/%1/%2/%3").arg(APP_ID, FILE_NAME, QString::number(TestUid))));
+    ASSERT_TRUE(errorMsg.isEmpty());
+
+    ASSERT_FALSE(server->acquireConnection(service, TestUid, APP_ID, "example_noexist", QString(""), errorMsg));
+    ASSERT_FALSE(errorMsg.isEmpty());
+    ASSERT_EQ(server->resourceSize(), 1);
+}
+
 TEST_F(ut_DConfigServer, resourceSize) {
 
     auto path1 = server->acquireManager(APP_ID, FILE_NAME, QString("")).path();
@@ -474,3 +500,297 @@ TEST_F(ut_DConfigServer, removeUserDataSimpleValidation) {
     ASSERT_EQ(conn2->value("canExit").variant().toBool(), true) 
         << "New connection should return default value after removeUserData";
 }
+
+TEST_F(ut_DConfigServer, removeUserDataAfterResourceRemoved) {
+    const uint testUid = 1007;
+    const uint otherUid = 1008;
+    const QString subpath = "test/subdir";
+
+    auto path = server->acquireManagerV2(testUid, APP_ID, FILE_NAME, QString("")).path();
+    auto subpathPath = server->acquireManagerV2(testUid, APP_ID, FILE_NAME, subpath).path();
+    ASSERT_EQ(server->resourceSize(), 2);
+
+    // the uid index keeps the removed resource until it's looked up.
+    {
+        auto resource = server->resourceObject(getGenericResourceKey(path));
+        ASSERT_TRUE(resource);
+        auto conn = resource->getConn(APP_ID, testUid);
+        ASSERT_TRUE(conn);
+        conn->release();
+    }
+    ASSERT_FALSE(server->resourceObject(getGenericResourceKey(path)));
+    ASSERT_EQ(server->resourceSize(), 1);
+
+    // the resource of the same key is created again for another user.
+    server->acquireManagerV2(otherUid, APP_ID, FILE_NAME, QString(""));
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    ASSERT_TRUE(resource->getConn(APP_ID, otherUid));
+
+    server->removeUserData(testUid);
+    ASSERT_FALSE(server->resourceObject(getGenericResourceKey(subpathPath)));
+    ASSERT_TRUE(resource->getConn(APP_ID, otherUid));
+    ASSERT_EQ(server->resourceSize(), 1);
+
+    // the index is empty for the user, and it's rebuilt by the next acquire.
+    server->removeUserData(testUid);
+    ASSERT_TRUE(resource->getConn(APP_ID, otherUid));
+    server->acquireManagerV2(testUid, APP_ID, FILE_NAME, QString(""));
+    ASSERT_TRUE(resource->getConn(APP_ID, testUid));
+    server->removeUserData(testUid);
+    ASSERT_FALSE(resource->getConn(APP_ID, testUid));
+    ASSERT_EQ(resource->connSize(), 1);
+    ASSERT_EQ(resource->getConnectionsByUid(otherUid).size(), 1);
+}
+
+static QString signatureSnapshotPath()
+{
+    return QString("%1/%2/signatures").arg(LocalPrefix, configPrefixPath());
+}
+
+// configuration file -> size recorded in the signature snapshot, the size is changed if `changedSize` is valid.
+static QHash<QString, qint64> signatureSnapshotSizes(const QString &changedFile = QString(), qint64 changedSize = -1,
+                                                     qint64 *lastFullScanTime = nullptr)
+{
+    QFile file(signatureSnapshotPath());
+    if (!file.exists() || !file.open(QIODevice::ReadWrite))
+        return {};
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_11);
+    quint32 magic = 0, version = 0, count = 0;
+    qint64 scanTime = 0;
+    QStringList roots;
+    QHash<QString, qint64> times;
+    stream >> magic >> version >> scanTime >> roots >> times >> count;
+    if (lastFullScanTime)
+        *lastFullScanTime = scanTime;
+
+    QHash<QString, qint64> sizes;
+    QList<std::tuple<QString, qint64, QDateTime>> signatures;
+    for (quint32 i = 0; i < count; i++) {
+        QString filePath;
+        qint64 size = 0;
+        QDateTime changeTime;
+        stream >> filePath >> size >> changeTime;
+        if (filePath == changedFile && changedSize >= 0)
+            size = changedSize;
+        sizes.insert(filePath, size);
+        signatures << std::make_tuple(filePath, size, changeTime);
+    }
+
+    if (changedSize >= 0) {
+        file.resize(0);
+        file.seek(0);
+        stream << magic << version << scanTime << roots << times << count;
+        for (const auto &signature : std::as_const(signatures))
+            stream << std::get<0>(signature) << std::get<1>(signature) << std::get<2>(signature);
+    }
+    return sizes;
+}
+
+TEST_F(ut_DConfigServer, signatureSnapshotDetectsChanges) {
+    const auto appFile = QDir::cleanPath(configPath());
+    const auto noAppIdFile = QDir::cleanPath(noAppIdConfigPath());
+    const auto addedFile = QFileInfo(appFile).path() + "/example2.json";
+    QFile::remove(signatureSnapshotPath());
+
+    const auto startTime = QDateTime::currentMSecsSinceEpoch();
+    server->initialize();
+    server.reset();
+    qint64 lastFullScanTime = 0;
+    auto sizes = signatureSnapshotSizes(QString(), -1, &lastFullScanTime);
+    ASSERT_EQ(sizes.value(appFile, -1), QFileInfo(appFile).size());
+    ASSERT_FALSE(sizes.contains(addedFile));
+    // all files are scanned without the snapshot, the deferred verification isn't needed in the interval.
+    ASSERT_GE(lastFullScanTime, startTime);
+
+    // the directory of `noAppIdFile` isn't changed, its signature is taken from the snapshot.
+    signatureSnapshotSizes(noAppIdFile, 1);
+    // added while the daemon is down, it changes the modified time of the directory.
+    QThread::msleep(10);
+    ASSERT_TRUE(QFile::copy(":/config/example.json", addedFile));
+
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->initialize();
+    server.reset();
+    qint64 loadedScanTime = 0;
+    sizes = signatureSnapshotSizes(QString(), -1, &loadedScanTime);
+    ASSERT_EQ(sizes.value(addedFile, -1), QFileInfo(addedFile).size());
+    ASSERT_EQ(sizes.value(noAppIdFile, -1), 1);
+    // loading the snapshot isn't a full scan.
+    ASSERT_EQ(loadedScanTime, lastFullScanTime);
+
+    // files changed in place are found by the verification after startup.
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->initialize();
+    server->reload();
+    server.reset();
+    sizes = signatureSnapshotSizes();
+    ASSERT_EQ(sizes.value(noAppIdFile, -1), QFileInfo(noAppIdFile).size());
+
+    QFile::remove(addedFile);
+    QFile::remove(signatureSnapshotPath());
+}
+
+TEST_F(ut_DConfigServer, signatureSnapshotBroken) {
+    const auto appFile = QDir::cleanPath(configPath());
+    QFile::remove(signatureSnapshotPath());
+
+    server->initialize();
+    server.reset();
+
+    // the truncated snapshot is ignored, all files are scanned.
+    signatureSnapshotSizes(appFile, 1);
+    {
+        QFile file(signatureSnapshotPath());
+        ASSERT_TRUE(file.resize(file.size() - 4));
+    }
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->initialize();
+    server.reset();
+    ASSERT_EQ(signatureSnapshotSizes().value(appFile, -1), QFileInfo(appFile).size());
+
+    // so is the corrupt one.
+    {
+        QFile file(signatureSnapshotPath());
+        ASSERT_TRUE(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        file.write("corrupt signature snapshot");
+    }
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->initialize();
+    server.reset();
+    ASSERT_EQ(signatureSnapshotSizes().value(appFile, -1), QFileInfo(appFile).size());
+
+    QFile::remove(signatureSnapshotPath());
+}
+
+static int storedFileCount(DSGConfigServer *server)
+{
+    return server->statistics().value("queues").toMap().value("metaStore").toInt();
+}
+
+TEST_F(ut_DConfigServer, preloadIntoStore) {
+    const auto accessProfilePath = QString("%1/%2/access-profile").arg(LocalPrefix, configPrefixPath());
+    ConfigAccessProfile profile;
+    profile.record(APP_ID, FILE_NAME, "");
+    ASSERT_TRUE(profile.save(accessProfilePath, 10));
+
+    // it's loaded on the loader when idle, and kept in the store.
+    server->initialize();
+    QElapsedTimer timer;
+    timer.start();
+    while (storedFileCount(server.data()) <= 0 && timer.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    ASSERT_EQ(storedFileCount(server.data()), 1);
+
+    // the preloaded file is dropped when its meta is updated.
+    server->update(QDir::cleanPath(configPath()));
+    ASSERT_EQ(storedFileCount(server.data()), 0);
+
+    server.reset();
+    QFile::remove(accessProfilePath);
+    QFile::remove(signatureSnapshotPath());
+}
+
+TEST_F(ut_DConfigServer, replayJournal) {
+    const uint testUid = 1003;
+    const auto journalDirectory = QString("%1/%2/journal").arg(LocalPrefix, configPrefixPath());
+    const QString crashedDirectory("/tmp/example/journal-crashed");
+    QDir(journalDirectory).removeRecursively();
+    QDir(crashedDirectory).removeRecursively();
+
+    server->initialize();
+    auto path = server->acquireManagerV2(testUid, APP_ID, FILE_NAME, QString("")).path();
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    auto conn = resource->getConn(APP_ID, testUid);
+    ASSERT_TRUE(conn);
+    conn->setValue("canExit", QDBusVariant{false});
+
+    // the record is written before the reply, keep the segments as if the daemon crashed before saving.
+    const auto &segments = ConfigJournal::segments(journalDirectory);
+    ASSERT_FALSE(segments.isEmpty());
+    ASSERT_TRUE(QDir().mkpath(crashedDirectory));
+    for (const auto &segment : segments)
+        ASSERT_TRUE(QFile::copy(segment, crashedDirectory + "/" + QFileInfo(segment).fileName()));
+
+    // the cache file isn't saved.
+    server->removeUserData(testUid);
+    server.reset();
+    for (const auto &segment : segments) {
+        QFile::remove(segment);
+        ASSERT_TRUE(QFile::rename(crashedDirectory + "/" + QFileInfo(segment).fileName(), segment));
+    }
+
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->setDelayReleaseTime(0);
+    server->initialize();
+    for (const auto &segment : segments)
+        ASSERT_FALSE(QFile::exists(segment));
+
+    path = server->acquireManagerV2(testUid, APP_ID, FILE_NAME, QString("")).path();
+    resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    conn = resource->getConn(APP_ID, testUid);
+    ASSERT_TRUE(conn);
+    ASSERT_EQ(conn->value("canExit").variant().toBool(), false);
+
+    server->removeUserData(testUid);
+    server.reset();
+    QDir(crashedDirectory).removeRecursively();
+    QFile::remove(signatureSnapshotPath());
+}
+
+TEST_F(ut_DConfigServer, handoff) {
+    const auto handoffPath = QString("%1/%2/handoff").arg(LocalPrefix, configPrefixPath());
+    const auto accessProfilePath = QString("%1/%2/access-profile").arg(LocalPrefix, configPrefixPath());
+    const auto addedFile = QFileInfo(configPath()).path() + "/example2.json";
+    QFile::remove(handoffPath);
+
+    server->initialize();
+    auto path = server->acquireManagerV2(TestUid, APP_ID, FILE_NAME, QString("")).path();
+    ASSERT_EQ(server->resourceSize(), 1);
+    server.reset();
+    ASSERT_TRUE(QFile::exists(handoffPath));
+
+    // the connection is registered again when its file is loaded on the loader.
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->setDelayReleaseTime(0);
+    server->initialize();
+    ASSERT_FALSE(QFile::exists(handoffPath));
+    QElapsedTimer timer;
+    timer.start();
+    while (server->resourceSize() <= 0 && timer.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    auto resource = server->resourceObject(getGenericResourceKey(path));
+    ASSERT_TRUE(resource);
+    ASSERT_TRUE(resource->getConn(APP_ID, TestUid));
+    server.reset();
+    ASSERT_TRUE(QFile::exists(handoffPath));
+
+    // it's discarded if the configuration files are changed.
+    QThread::msleep(10);
+    ASSERT_TRUE(QFile::copy(":/config/example.json", addedFile));
+    server.reset(new DSGConfigServer);
+    server->setLocalPrefix(LocalPrefix);
+    server->setDelayReleaseTime(0);
+    server->initialize();
+    ASSERT_FALSE(QFile::exists(handoffPath));
+    timer.restart();
+    while (timer.elapsed() < 100)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    ASSERT_EQ(server->resourceSize(), 0);
+
+    server.reset();
+    QFile::remove(addedFile);
+    QFile::remove(handoffPath);
+    QFile::remove(accessProfilePath);
+    QFile::remove(signatureSnapshotPath());
+}
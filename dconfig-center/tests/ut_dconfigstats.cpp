@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "dconfigstats.h"
+
+TEST(ut_ConfigLatencyHistogram, percentile) {
+    for (qint64 value = 0; value < 100000; value += 7) {
+        const auto index = ConfigLatencyHistogram::bucketIndex(value);
+        const auto upperBound = ConfigLatencyHistogram::bucketUpperBound(index);
+        ASSERT_GE(upperBound, value);
+        // relative error is limited by the sub buckets.
+        ASSERT_LE(upperBound - value, value / 8);
+        ASSERT_EQ(ConfigLatencyHistogram::bucketIndex(upperBound), index);
+    }
+
+    ConfigLatencyHistogram histogram;
+    ASSERT_EQ(histogram.percentile(50), 0);
+    for (int i = 1; i <= 100; i++)
+        histogram.record(i * 100);
+    ASSERT_EQ(histogram.count(), 100u);
+    ASSERT_EQ(histogram.max(), 10000);
+    ASSERT_EQ(histogram.sum(), 505000u);
+    ASSERT_GE(histogram.percentile(50), 5000);
+    ASSERT_LE(histogram.percentile(50), 5000 * 9 / 8);
+    ASSERT_GE(histogram.percentile(99), 9900);
+    ASSERT_EQ(histogram.percentile(100), 10000);
+
+    histogram.reset();
+    ASSERT_EQ(histogram.count(), 0u);
+    ASSERT_EQ(histogram.max(), 0);
+
+    ConfigStatistics statistics;
+    ASSERT_EQ(ConfigStatistics::metric("acquireManagerV2"), ConfigStatistics::AcquireManager);
+    ASSERT_EQ(ConfigStatistics::metric("unknown"), ConfigStatistics::MetricCount);
+    {
+        ConfigLatencyTimer timer(&statistics, ConfigStatistics::Value);
+    }
+    {
+        ConfigLatencyTimer timer(&statistics, ConfigStatistics::SetValue);
+        timer.cancel();
+    }
+    ASSERT_EQ(statistics.histogram(ConfigStatistics::Value).count(), 1u);
+    ASSERT_EQ(statistics.histogram(ConfigStatistics::SetValue).count(), 0u);
+}
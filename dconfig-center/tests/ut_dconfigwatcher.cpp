@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QDir>
+#include <QFile>
+#include <QSignalSpy>
+
+#include <gtest/gtest.h>
+
+#include "dconfigwatcher.h"
+
+TEST(ut_ConfigFileWatcher, filesChanged) {
+    const QString directory("/tmp/example/watcher");
+    QDir(directory).removeRecursively();
+
+    ConfigFileWatcher watcher;
+    watcher.setDelayTime(10);
+    // the root is watched after it's created.
+    ASSERT_TRUE(watcher.start({directory + "/configs"}));
+
+    QSignalSpy spy(&watcher, &ConfigFileWatcher::filesChanged);
+    ASSERT_TRUE(QDir().mkpath(directory + "/configs/org.foo.appid"));
+    QFile file(directory + "/configs/org.foo.appid/example.json");
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("{}");
+    file.close();
+
+    QStringList paths;
+    while (!paths.contains(file.fileName()) && spy.wait(1000))
+        paths << spy.takeFirst().at(0).toStringList();
+    ASSERT_TRUE(paths.contains(file.fileName()));
+
+    // not configuration files are ignored.
+    QFile other(directory + "/configs/org.foo.appid/example.txt");
+    ASSERT_TRUE(other.open(QIODevice::WriteOnly));
+    other.close();
+    paths.clear();
+    while (spy.wait(100))
+        paths << spy.takeFirst().at(0).toStringList();
+    ASSERT_FALSE(paths.contains(other.fileName()));
+
+    ASSERT_TRUE(QDir(directory + "/configs/org.foo.appid").removeRecursively());
+    paths.clear();
+    while (!paths.contains(directory + "/configs/org.foo.appid") && spy.wait(1000))
+        paths << spy.takeFirst().at(0).toStringList();
+    ASSERT_TRUE(paths.contains(directory + "/configs/org.foo.appid"));
+
+    watcher.stop();
+    QDir(directory).removeRecursively();
+}
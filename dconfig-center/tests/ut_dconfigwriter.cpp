@@ -0,0 +1,108 @@
+// SPDX-FileCopyrightText: 2026 Uniontech Software Technology Co.,Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QThread>
+
+#include <gtest/gtest.h>
+
+#include "dconfigwriter.h"
+#include "dconfigstats.h"
+
+TEST(ut_ConfigPersistenceWriter, order) {
+    ConfigPersistenceWriter writer;
+    QMutex mutex;
+    QStringList saved;
+    auto job = [&mutex, &saved](const QString &name) {
+        return [&mutex, &saved, name]() {
+            QThread::msleep(1);
+            QMutexLocker locker(&mutex);
+            saved << name;
+        };
+    };
+
+    writer.post("file1", job("file1-1"));
+    writer.post("file2", job("file2-1"));
+    writer.post("file1", job("file1-2"));
+
+    writer.wait("file1");
+    {
+        QMutexLocker locker(&mutex);
+        ASSERT_EQ(saved.indexOf("file1-1"), 0);
+        ASSERT_EQ(saved.indexOf("file1-2"), 2);
+    }
+
+    writer.post("file2", job("file2-2"));
+    writer.drain();
+    ASSERT_EQ(writer.pendingCount(), 0);
+    ASSERT_EQ(saved, QStringList({"file1-1", "file2-1", "file1-2", "file2-2"}));
+
+    // run directly after stopped.
+    writer.stop();
+    writer.post("file1", job("file1-3"));
+    ASSERT_EQ(saved.last(), QString("file1-3"));
+}
+
+TEST(ut_ConfigPersistenceWriter, snapshot) {
+    const QString localPrefix("/tmp/example/writer");
+    QDir(localPrefix).removeRecursively();
+
+    ConfigStatistics statistics;
+    ConfigPersistenceWriter writer;
+    writer.setStatistics(&statistics);
+    QString stagingPath;
+    QByteArray content("{\"value\": 1}");
+    auto save = [&stagingPath, &content](const QString &prefix) {
+        stagingPath = prefix + "/config/1000/example.json";
+        QDir().mkpath(QFileInfo(stagingPath).path());
+        QFile file(stagingPath);
+        return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+    };
+
+    const auto &snapshots = writer.capture("example", save, localPrefix);
+    ASSERT_EQ(snapshots.size(), 1);
+    ASSERT_EQ(snapshots.first().path, localPrefix + "/config/1000/example.json");
+    ASSERT_FALSE(QFile::exists(stagingPath));
+
+    // the object is modified after it's captured, the snapshot is written.
+    content = "{\"value\": 2}";
+    writer.write("example", snapshots);
+    writer.wait("example");
+
+    QFile file(localPrefix + "/config/1000/example.json");
+    ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+    ASSERT_EQ(file.readAll(), QByteArray("{\"value\": 1}"));
+    ASSERT_TRUE(writer.takeFailedIds().isEmpty());
+    // the size of the written snapshots.
+    ASSERT_EQ(statistics.bytesWritten(), static_cast<quint64>(QByteArray("{\"value\": 1}").size()));
+    ASSERT_EQ(statistics.histogram(ConfigStatistics::SyncWrite).count(), 1u);
+    QDir(localPrefix).removeRecursively();
+}
+
+TEST(ut_ConfigPersistenceWriter, failure) {
+    const QString localPrefix("/tmp/example/writer");
+    QDir(localPrefix).removeRecursively();
+    QDir().mkpath(localPrefix);
+    // the parent directory can't be created over a file.
+    QFile blocker(localPrefix + "/config");
+    ASSERT_TRUE(blocker.open(QIODevice::WriteOnly));
+    blocker.close();
+
+    ConfigPersistenceWriter writer;
+    writer.write("example", {{localPrefix + "/config/1000/example.json", "{}"}});
+    writer.write("other", {{localPrefix + "/other.json", "{}"}});
+    writer.drain();
+    ASSERT_EQ(writer.takeFailedIds(), QStringList{"example"});
+    // failures are taken once.
+    ASSERT_TRUE(writer.takeFailedIds().isEmpty());
+
+    QFile::remove(blocker.fileName());
+    writer.write("example", {{localPrefix + "/config/1000/example.json", "{}"}});
+    writer.drain();
+    ASSERT_TRUE(writer.takeFailedIds().isEmpty());
+    QDir(localPrefix).removeRecursively();
+}